@@ -24,6 +24,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <QFile>
@@ -34,34 +36,40 @@
 
 #include "basedatalog.h"
 
-void TimeProviderBase::logTimeAccess(double time)
+bool readDataLogHeader(QDataStream& in)
 {
-    const WTF::EventActionDescriptor descriptor = WebCore::threadGlobalData().threadTimers().eventActionRegister()->currentEventActionDispatching();
+    quint32 magic;
+    quint32 version;
+    in >> magic >> version;
 
-    if (descriptor.isNull()) {
-        return;
+    if (in.status() == QDataStream::Ok && magic == DescriptorLog<double>::MAGIC && version == DescriptorLog<double>::VERSION) {
+        return true;
     }
 
-    QString ident = QString::fromStdString(descriptor.toString());
+    in.resetStatus();
+    in.device()->seek(0);
 
-    Log::iterator iter = m_log.find(ident);
+    return false;
+}
 
-    if (iter == m_log.end()) {
-        LogEntries logEntries;
-        logEntries.append(time);
-        m_log.insert(ident, logEntries);
+bool LatencyLog::percentile(const QString& type, double p, int minSamples, quint32* result) const
+{
+    QHash<QString, Samples>::const_iterator iter = m_samples.find(type);
 
-    } else {
-        iter->append(time);
+    if (iter == m_samples.end() || iter.value().size() < std::max(1, minSamples)) {
+        return false;
     }
-}
 
-void TimeProviderBase::attach()
-{
-    JSC::TimeProvider::setInstance(this);
+    Samples sorted = iter.value();
+    std::sort(sorted.begin(), sorted.end());
+
+    int rank = (int)std::ceil(p * sorted.size());
+    *result = sorted.at(std::min(std::max(rank, 1), sorted.size()) - 1);
+
+    return true;
 }
 
-void TimeProviderBase::writeLogFile(QString path)
+void LatencyLog::writeLogFile(QString path) const
 {
     QFile fp(path);
     fp.open(QIODevice::WriteOnly);
@@ -69,55 +77,88 @@ void TimeProviderBase::writeLogFile(QString path)
     ASSERT(fp.isOpen());
 
     QDataStream out(&fp);
-    out << m_log;
+    out << (quint32)MAGIC << (quint32)VERSION;
+    out << m_samples;
 
     fp.close();
 }
 
-void RandomProviderBase::logRandomAccess(double random)
+bool LatencyLog::readLogFile(QString path)
 {
+    QFile fp(path);
 
-    const WTF::EventActionDescriptor descriptor = WebCore::threadGlobalData().threadTimers().eventActionRegister()->currentEventActionDispatching();
+    if (!fp.open(QIODevice::ReadOnly)) {
+        return false;
+    }
 
-    if (descriptor.isNull()) {
-        return;
+    QDataStream in(&fp);
+
+    quint32 magic;
+    quint32 version;
+    in >> magic >> version;
+
+    if (in.status() != QDataStream::Ok || magic != MAGIC || version != VERSION) {
+        return false;
     }
 
-    QString ident = QString::fromStdString(descriptor.toString());
+    in >> m_samples;
 
-    DLog::iterator iter = m_double_log.find(ident);
+    return in.status() == QDataStream::Ok;
+}
 
-    if (iter == m_double_log.end()) {
-        DLogEntries logEntries;
-        logEntries.append(random);
-        m_double_log.insert(ident, logEntries);
+void TimeProviderBase::logTimeAccess(double time)
+{
+    const WebCore::EventActionRegister* eventActionRegister = WebCore::threadGlobalData().threadTimers().eventActionRegister();
+    const WTF::EventActionDescriptor& descriptor = eventActionRegister->currentEventActionDispatching();
 
-    } else {
-        iter->append(random);
+    if (descriptor.isNull()) {
+        return;
     }
+
+    m_log.append(eventActionRegister->currentEventActionDispatchNumber(), descriptor, time);
 }
 
-void RandomProviderBase::logRandomAccessUint32(unsigned random)
+void TimeProviderBase::attach()
 {
+    JSC::TimeProvider::setInstance(this);
+}
 
-    const WTF::EventActionDescriptor descriptor = WebCore::threadGlobalData().threadTimers().eventActionRegister()->currentEventActionDispatching();
+void TimeProviderBase::writeLogFile(QString path)
+{
+    QFile fp(path);
+    fp.open(QIODevice::WriteOnly);
+
+    ASSERT(fp.isOpen());
+
+    QDataStream out(&fp);
+    out << (quint32)Log::MAGIC << (quint32)Log::VERSION;
+    m_log.write(out);
+
+    fp.close();
+}
+
+void RandomProviderBase::logRandomAccess(double random)
+{
+    const WebCore::EventActionRegister* eventActionRegister = WebCore::threadGlobalData().threadTimers().eventActionRegister();
+    const WTF::EventActionDescriptor& descriptor = eventActionRegister->currentEventActionDispatching();
 
     if (descriptor.isNull()) {
         return;
     }
 
-    QString ident = QString::fromStdString(descriptor.toString());
-
-    ULog::iterator iter = m_unsigned_log.find(ident);
+    m_double_log.append(eventActionRegister->currentEventActionDispatchNumber(), descriptor, random);
+}
 
-    if (iter == m_unsigned_log.end()) {
-        ULogEntries logEntries;
-        logEntries.append(random);
-        m_unsigned_log.insert(ident, logEntries);
+void RandomProviderBase::logRandomAccessUint32(unsigned random)
+{
+    const WebCore::EventActionRegister* eventActionRegister = WebCore::threadGlobalData().threadTimers().eventActionRegister();
+    const WTF::EventActionDescriptor& descriptor = eventActionRegister->currentEventActionDispatching();
 
-    } else {
-        iter->append(random);
+    if (descriptor.isNull()) {
+        return;
     }
+
+    m_unsigned_log.append(eventActionRegister->currentEventActionDispatchNumber(), descriptor, random);
 }
 
 void RandomProviderBase::attach()
@@ -133,9 +174,9 @@ void RandomProviderBase::writeLogFile(QString path)
     ASSERT(fp.isOpen());
 
     QDataStream out(&fp);
-    out << m_double_log;
-    out << m_unsigned_log;
+    out << (quint32)DLog::MAGIC << (quint32)DLog::VERSION;
+    m_double_log.write(out);
+    m_unsigned_log.write(out);
 
     fp.close();
 }
-
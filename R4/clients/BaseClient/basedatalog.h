@@ -29,10 +29,162 @@
 
 #include <QHash>
 #include <QList>
+#include <QVector>
+#include <QString>
+#include <QDataStream>
 
 #include "JavaScriptCore/runtime/timeprovider.h"
 #include "JavaScriptCore/runtime/randomprovider.h"
 
+#include <wtf/EventActionDescriptor.h>
+
+/**
+ * Values (time or random) logged per event action.
+ *
+ * Stored as a table of event action descriptors, followed by a contiguous array of values for each descriptor. The
+ * descriptor of the event action currently dispatching is resolved once per dispatch, such that repeated accesses within
+ * an event action do not build or hash the descriptor string.
+ */
+template <typename T>
+class DescriptorLog {
+
+public:
+    typedef QVector<T> Entries;
+
+    enum {
+        MAGIC = 0x5234444c, // "R4DL"
+        VERSION = 1
+    };
+
+    DescriptorLog()
+        : m_cachedDispatchNumber(0)
+        , m_cachedIndex(-1)
+    {
+    }
+
+    int size() const {
+        return m_entries.size();
+    }
+
+    int indexOf(const QString& descriptor) const {
+        return m_index.value(descriptor, -1);
+    }
+
+    const Entries& entries(int index) const {
+        return m_entries.at(index);
+    }
+
+    void append(unsigned int dispatchNumber, const WTF::EventActionDescriptor& descriptor, T value) {
+
+        if (m_cachedIndex == -1 || m_cachedDispatchNumber != dispatchNumber) {
+            m_cachedIndex = insert(QString::fromStdString(descriptor.toString()));
+            m_cachedDispatchNumber = dispatchNumber;
+        }
+
+        m_entries[m_cachedIndex].append(value);
+    }
+
+    void write(QDataStream& out) const {
+        out << (quint32)m_descriptors.size();
+
+        foreach (const QString& descriptor, m_descriptors) {
+            out << descriptor;
+        }
+
+        foreach (const Entries& entries, m_entries) {
+            out << entries;
+        }
+    }
+
+    void read(QDataStream& in) {
+        quint32 size;
+        in >> size;
+
+        for (quint32 i = 0; i < size; ++i) {
+            QString descriptor;
+            in >> descriptor;
+            insert(descriptor);
+        }
+
+        for (quint32 i = 0; i < size; ++i) {
+            in >> m_entries[i];
+        }
+    }
+
+    // Logs written before the binary format, QHash<QString, QList<T> >
+    void readLegacy(QDataStream& in) {
+        QHash<QString, QList<T> > log;
+        in >> log;
+
+        typename QHash<QString, QList<T> >::const_iterator iter = log.begin();
+        for (; iter != log.end(); ++iter) {
+            m_entries[insert(iter.key())] = iter.value().toVector();
+        }
+    }
+
+private:
+    int insert(const QString& descriptor) {
+        QHash<QString, int>::const_iterator iter = m_index.find(descriptor);
+
+        if (iter != m_index.end()) {
+            return iter.value();
+        }
+
+        m_descriptors.append(descriptor);
+        m_entries.append(Entries());
+        m_index.insert(descriptor, m_entries.size() - 1);
+
+        return m_entries.size() - 1;
+    }
+
+    QList<QString> m_descriptors;
+    QVector<Entries> m_entries;
+    QHash<QString, int> m_index;
+
+    unsigned int m_cachedDispatchNumber;
+    int m_cachedIndex;
+};
+
+/**
+ * Reads the header of a log written by writeLogFile. Returns false, and rewinds the stream, for logs in the legacy format.
+ */
+bool readDataLogHeader(QDataStream& in);
+
+/**
+ * Scheduling latency observed while recording, per event action descriptor type.
+ *
+ * The latency of an event action is the time from the end of the previous event action until it became available to
+ * the scheduler (in miliseconds). Replay uses the distribution of each type to bound how long it waits for the next
+ * event action in the schedule, instead of waiting a fixed amount of time for every type.
+ */
+class LatencyLog {
+
+public:
+    typedef QVector<quint32> Samples;
+
+    enum {
+        MAGIC = 0x52344c54, // "R4LT"
+        VERSION = 1
+    };
+
+    void append(const QString& type, quint32 latency) {
+        m_samples[type].append(latency);
+    }
+
+    const QHash<QString, Samples>& samples() const {
+        return m_samples;
+    }
+
+    // Nearest-rank percentile (0 < p <= 1) of the latencies of a type, false if fewer than minSamples were observed
+    bool percentile(const QString& type, double p, int minSamples, quint32* result) const;
+
+    void writeLogFile(QString path) const;
+    bool readLogFile(QString path);
+
+private:
+    QHash<QString, Samples> m_samples;
+};
+
 class TimeProviderBase : public JSC::TimeProviderDefault {
 
 public:
@@ -47,8 +199,7 @@ public:
     void writeLogFile(QString path);
 
 protected:
-    typedef QList<double> LogEntries;
-    typedef QHash<QString, LogEntries> Log;
+    typedef DescriptorLog<double> Log;
 
 private:
     Log m_log;
@@ -69,15 +220,13 @@ public:
     void writeLogFile(QString path);
 
 protected:
-    typedef QList<double> DLogEntries;
-    typedef QHash<QString, DLogEntries> DLog;
+    typedef DescriptorLog<double> DLog;
 
 private:
     DLog m_double_log;
 
 protected:
-    typedef QList<unsigned> ULogEntries;
-    typedef QHash<QString, ULogEntries> ULog;
+    typedef DescriptorLog<unsigned> ULog;
 
 private:
     ULog m_unsigned_log;
@@ -175,11 +175,21 @@ void BaseWindow::closeEvent(QCloseEvent *event)
 
 void BaseWindow::takeScreenshot(const QString &destinationFile)
 {
-    page()->mainFrame()->setScrollBarPolicy(Qt::Vertical, Qt::ScrollBarAlwaysOff);
-    page()->mainFrame()->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
-    page()->setViewportSize(page()->mainFrame()->contentsSize());
+    renderScreenshot().save(destinationFile);
+}
+
+QImage BaseWindow::renderScreenshot()
+{
+    return renderScreenshot(page());
+}
+
+QImage BaseWindow::renderScreenshot(QWebPage* page)
+{
+    page->mainFrame()->setScrollBarPolicy(Qt::Vertical, Qt::ScrollBarAlwaysOff);
+    page->mainFrame()->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
+    page->setViewportSize(page->mainFrame()->contentsSize());
 
-    QSize size = page()->mainFrame()->contentsSize();
+    QSize size = page->mainFrame()->contentsSize();
 
     if (size.width() == 0) {
         size.setWidth(1024);
@@ -196,8 +206,8 @@ void BaseWindow::takeScreenshot(const QString &destinationFile)
     p.setRenderHint(QPainter::Antialiasing, true);
     p.setRenderHint(QPainter::TextAntialiasing, true);
     p.setRenderHint(QPainter::SmoothPixmapTransform, true);
-    page()->mainFrame()->render(&p);
+    page->mainFrame()->render(&p);
     p.end();
 
-    image.save(destinationFile);
+    return image;
 }
@@ -33,6 +33,7 @@
 #ifndef basewindow_h
 #define basewindow_h
 
+#include <QImage>
 #include <QMainWindow>
 #include <QStringListModel>
 #include <QToolBar>
@@ -56,6 +57,8 @@ public:
     void closeEvent(QCloseEvent *event);
 
     void takeScreenshot(const QString& destinationFile);
+    QImage renderScreenshot();
+    static QImage renderScreenshot(QWebPage* page);
 
 signals:
     void sigOnCloseEvent();
@@ -1,9 +1,16 @@
 
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
 #include "clientapplication.h"
+#include "utils.h"
 
-ClientApplication::ClientApplication(int& argc, char** argv)
+ClientApplication::ClientApplication(int& argc, char** argv, bool supportsHeadless)
     : QApplication(argc, argv, QApplication::GuiServer)
+    , m_window(0)
     , m_programName("record")
+    , m_headlessPage(0)
 {
     applyDefaultSettings();
 
@@ -16,12 +23,104 @@ ClientApplication::ClientApplication(int& argc, char** argv)
     // Important, accessible from the JS environment
     this->setApplicationName("R4");
 
+    if (supportsHeadless && args.contains("-headless")) {
+        m_headlessPage = new QWebPage(this);
+        m_headlessPage->setViewportSize(QSize(800, 600)); // the ToolWindow size, clients should set the recorded viewport
+
+        ToolWindow::applyPrefs(m_headlessPage);
+        return;
+    }
+
     m_window = new ToolWindow();
 }
 
+#ifndef Q_WS_QPA
+static bool hasDisplayArgument(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-display") == 0)
+            return true;
+    }
+
+    return false;
+}
+#endif
+
+void ClientApplication::prepareHeadless(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-headless") == 0) {
+#ifdef Q_WS_QPA
+            // Only QPA (Lighthouse) builds of Qt 4 can run without a display server, an explicit
+            // -platform argument or QT_QPA_PLATFORM takes precedence.
+            setenv("QT_QPA_PLATFORM", "minimal", 0);
+#else
+            // Other builds connect to a display server even if no window is ever shown, fail before
+            // Qt aborts with a less helpful message.
+            if (!hasDisplayArgument(argc, argv)) {
+                const char* display = getenv("DISPLAY");
+
+                if (display == 0 || display[0] == '\0') {
+                    std::cerr << "Error: -headless needs a display server with this (non-QPA) build of Qt. "
+                              << "Build Qt with -qpa to run without one, or set DISPLAY (e.g. to an Xvfb server)."
+                              << std::endl;
+                    std::exit(1);
+                }
+            }
+#endif
+            return;
+        }
+    }
+}
+
 void ClientApplication::loadWebsite(QString url)
 {
-    m_window->load(url);
+    if (!isHeadless()) {
+        m_window->load(url);
+        return;
+    }
+
+    QUrl qurl = urlFromUserInput(url);
+
+    if (qurl.scheme().isEmpty())
+        qurl = QUrl("http://" + url + "/");
+
+    if (qurl.isValid())
+        m_headlessPage->mainFrame()->load(qurl);
+}
+
+void ClientApplication::setHeadlessViewportSize(const QSize& size)
+{
+    // Windowed views are sized by their ToolWindow
+    if (isHeadless())
+        m_headlessPage->setViewportSize(size);
+}
+
+QWebPage* ClientApplication::page() const
+{
+    return isHeadless() ? m_headlessPage : m_window->page();
+}
+
+QImage ClientApplication::renderScreenshot()
+{
+    return BaseWindow::renderScreenshot(page());
+}
+
+void ClientApplication::showWindow()
+{
+    if (!isHeadless())
+        m_window->show();
+}
+
+void ClientApplication::closeWindow()
+{
+    if (isHeadless()) {
+        // There is no last window to close, leave the event loop directly
+        quit();
+        return;
+    }
+
+    m_window->close();
 }
 
 void ClientApplication::applyDefaultSettings()
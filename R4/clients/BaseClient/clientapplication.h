@@ -6,7 +6,9 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QFontDatabase>
+#include <QImage>
 #include <QString>
+#include <QWebPage>
 
 #include "toolwindow.h"
 
@@ -14,17 +16,44 @@ class ClientApplication : public QApplication {
     Q_OBJECT
 
 public:
-    ClientApplication(int& argc, char** argv);
+    /**
+     * Clients passing supportsHeadless accept the -headless option. In headless mode no ToolWindow
+     * (QMainWindow, toolbar, QWebView) is created, and the client drives a bare QWebPage instead.
+     * Nothing is painted except when renderScreenshot() is called, which renders into an offscreen QImage.
+     *
+     * WebERA: m_window is 0 in headless mode, use page(), showWindow(), renderScreenshot() and closeWindow().
+     */
+    ClientApplication(int& argc, char** argv, bool supportsHeadless = false);
+
+    /**
+     * Select a display-less Qt platform plugin for -headless runs. Must be called before the
+     * application object is constructed.
+     *
+     * Only QPA builds of Qt 4 run without a display server. Other builds still connect to the
+     * X server in -headless mode, the client exits with an error if none is configured.
+     */
+    static void prepareHeadless(int argc, char** argv);
 
 protected:
     void loadWebsite(QString url);
 
+    QWebPage* page() const;
+    QImage renderScreenshot();
+    void showWindow();
+    void closeWindow();
+
+    bool isHeadless() const { return m_headlessPage != 0; }
+    void setHeadlessViewportSize(const QSize& size);
+
 private:
     void applyDefaultSettings();
 
 protected:
     ToolWindow* m_window;
     QString m_programName;
+
+private:
+    QWebPage* m_headlessPage;
 };
 
 #endif // CLIENTAPPLICATION_H
@@ -95,7 +95,7 @@ void ToolWindow::initializeView()
     connect(page(), SIGNAL(loadStarted()), this, SLOT(loadStarted()));
     connect(page(), SIGNAL(loadFinished(bool)), this, SLOT(loadFinished()));
 
-    applyPrefs();
+    applyPrefs(page());
 
     splitter->addWidget(m_inspector);
     m_inspector->setPage(page());
@@ -114,9 +114,9 @@ void ToolWindow::setRemoteInspectionPort(uint port)
     page()->setProperty("_q_webInspectorServerPort", port);
 }
 
-void ToolWindow::applyPrefs()
+void ToolWindow::applyPrefs(QWebPage* page)
 {
-    QWebSettings* settings = page()->settings();
+    QWebSettings* settings = page->settings();
     settings->setAttribute(QWebSettings::AcceleratedCompositingEnabled, false);
     settings->setAttribute(QWebSettings::TiledBackingStoreEnabled, false);
     settings->setAttribute(QWebSettings::FrameFlatteningEnabled, false);
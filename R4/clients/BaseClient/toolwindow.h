@@ -58,6 +58,9 @@ public:
 
     void setRemoteInspectionPort(uint port);
 
+    // Settings of every page driven by the clients, windowed or headless
+    static void applyPrefs(QWebPage* page);
+
 protected slots:
     void loadStarted();
     void loadFinished();
@@ -71,7 +74,6 @@ private:
     void init();
     void initializeView();
     void createChrome();
-    void applyPrefs();
 
 private:
     QWidget* m_view;
@@ -26,16 +26,34 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <config.h>
+
 #include "autoexplorer.h"
 
 #include <iostream>
 #include <QDebug>
 #include <QWebPage>
 
+#include <WebCore/platform/ThreadTimers.h>
+#include <WebCore/platform/ThreadGlobalData.h>
+#include <WebCore/platform/network/qt/QNetworkReplyHandler.h>
+
+#include "wtf/ActionLogReport.h"
+
+namespace {
+
+const int POLL_INTERVAL = 10; // ms, how often we check for quiescence
+const qint64 MAX_WAIT = 500; // ms, explore a busy page anyway after this long
+const qint64 RETRY_AFTER_FAILURE = 500; // ms, nothing to explore, wait for the page to change
+const unsigned int MAX_FAILED_ATTEMPTS = 10;
+
+}
+
 AutoExplorer::AutoExplorer(QMainWindow* window, QWebFrame* frame)
     : m_window(window)
     , m_frame(frame)
     , m_numFramesLoading(0)
+    , m_quiescenceThreshold(50)
     , m_numEventActionsExploredLimit(128)
     , m_numFailedExplorationAttempts(0)
 {
@@ -77,21 +95,54 @@ void AutoExplorer::explore(const QString& url, unsigned int preExploreTimeout, u
         connect(&m_explorationTimer, SIGNAL(timeout()), this, SLOT(stop()));
     }
 
-    // This timer is used to invoke each auto explored event action
+    // This timer polls for quiescence, and invokes each auto explored event action
     // The event action is invoked immediately when this timer is fired (it is not deferred to an internal timer)
 
-    m_explorationKeepAliveTimer.setInterval(500); // 500 ms
-    connect(&m_explorationKeepAliveTimer, SIGNAL(timeout()), this, SLOT(explorationKeepAlive()));
+    m_explorationPollTimer.setInterval(POLL_INTERVAL);
+    m_explorationPollTimer.setSingleShot(true);
+    connect(&m_explorationPollTimer, SIGNAL(timeout()), this, SLOT(explorationPoll()));
 }
 
-void AutoExplorer::explorationKeepAlive()
+bool AutoExplorer::isQuiescent() const
 {
     if (m_numFramesLoading != 0) {
-        m_explorationKeepAliveTimer.start();
+        return false;
+    }
+
+    WebCore::QNetworkReplyControllableFactory* network = WebCore::QNetworkReplyControllableFactory::getFactory();
+    if (network->pendingCounter() != 0) {
+        return false;
+    }
+
+    // Parser chunks, network snapshot updates and DOM timers are all timers, quiescent if none of them is due soon
+    double threshold = m_quiescenceThreshold / 1000.0;
+
+    const Vector<WebCore::TimerBase*>& timers = WebCore::threadGlobalData().threadTimers().timerHeap();
+    for (size_t i = 0; i < timers.size(); ++i) {
+        if (timers[i]->nextFireInterval() < threshold) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AutoExplorer::explorationPoll()
+{
+    qint64 waited = m_sinceLastAttempt.elapsed();
+
+    if (m_numFramesLoading != 0 || (m_numFailedExplorationAttempts != 0 && waited < RETRY_AFTER_FAILURE)) {
+        m_explorationPollTimer.start();
+        return;
+    }
+
+    if (!isQuiescent() && waited < MAX_WAIT) {
+        m_explorationPollTimer.start();
         return;
     }
 
     bool success = m_frame->runAutomaticExploration();
+    m_sinceLastAttempt.restart();
 
     if (success) {
 
@@ -105,20 +156,33 @@ void AutoExplorer::explorationKeepAlive()
     }
 
     // Stop if we have reached our execution limit or failure limit
-    if (m_numEventActionsExploredLimit == 0 || m_numFailedExplorationAttempts == 10) { // > 2.5 seconds
+    if (m_numEventActionsExploredLimit == 0 || m_numFailedExplorationAttempts == MAX_FAILED_ATTEMPTS) { // > 5 seconds
         stop();
         return;
     }
 
-    m_explorationKeepAliveTimer.start();
+    m_explorationPollTimer.start();
 
 }
 
 void AutoExplorer::stop() {
-    if (m_numFailedExplorationAttempts == 10) { // > 2.5 seconds
+    if (m_numFailedExplorationAttempts == MAX_FAILED_ATTEMPTS) {
         std::cerr << "Warning: Auto exploration not finished before stopping." << std::endl;
     }
 
+    m_explorationPollTimer.stop();
+
+    // Exploration progress per event type
+    for (int i = 0; i < EventAttachLog::EV_NUM_EVENTS; ++i) {
+        EventAttachLog::EventType type = static_cast<EventAttachLog::EventType>(i);
+        EventAttachLog::Counters counters = getEventAttachLog()->counters(type);
+
+        if (counters.added != 0) {
+            std::cout << "Auto exploration " << EventAttachLog::EventTypeStr(type) << ": " << counters.added << " attached, "
+                      << counters.pulled << " explored, " << counters.removed << " removed, " << counters.pending << " pending" << std::endl;
+        }
+    }
+
     disconnect(m_frame, 0, this, 0);
     emit done();
 }
@@ -144,7 +208,9 @@ void AutoExplorer::startAutoExploration()
 {
     connect(m_frame, SIGNAL(urlChanged(QUrl)), this, SLOT(differentUrl(QUrl)));
 
-    m_explorationKeepAliveTimer.start();
+    m_sinceLastAttempt.start();
+
+    m_explorationPollTimer.start();
     m_explorationTimer.start();
 
     m_preExplorationTimer.stop();
@@ -26,9 +26,17 @@
 
 #include "qwebframe.h"
 
+#include <QElapsedTimer>
 #include <QMainWindow>
 #include <QTimer>
 
+/**
+ * Explores a loaded page by running automatic exploration event actions.
+ *
+ * WebERA: An event action is explored as soon as the page is quiescent, i.e. no frame is loading, no network request
+ * is waiting for its reply, and no timer (including parser chunks and network snapshot updates) is due within the
+ * quiescence threshold. Pages which never become quiescent (e.g. animations) are explored after a maximum wait.
+ */
 class AutoExplorer : public QObject {
     Q_OBJECT
 
@@ -38,13 +46,17 @@ public:
 public slots:
     void explore(const QString& url, unsigned int preExploreTimeout, unsigned int explorationTimeout);
 
+    void setQuiescenceThreshold(unsigned int miliseconds) {
+        m_quiescenceThreshold = miliseconds;
+    }
+
 private slots:
     void frameLoadStarted();
     void frameLoadFinished();
     void differentPage();
     void differentUrl(QUrl);
     void stop();
-    void explorationKeepAlive();
+    void explorationPoll();
 
 signals:
     void done();
@@ -52,6 +64,7 @@ signals:
 private:
 
     void startAutoExploration();
+    bool isQuiescent() const;
 
     QMainWindow* m_window;
     QWebFrame* m_frame;
@@ -61,7 +74,10 @@ private:
     QTimer m_preExplorationTimer;
     QTimer m_explorationTimer;
 
-    QTimer m_explorationKeepAliveTimer;
+    QTimer m_explorationPollTimer;
+    QElapsedTimer m_sinceLastAttempt;
+
+    unsigned int m_quiescenceThreshold; // miliseconds
 
     unsigned int m_numEventActionsExploredLimit;
     unsigned int m_numFailedExplorationAttempts;
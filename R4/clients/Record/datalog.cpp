@@ -34,9 +34,28 @@
 
 #include "datalog.h"
 
+const double TimeProviderRecord::VIRTUAL_CLOCK_EPOCH = 1388534400000.0;
+const double TimeProviderRecord::VIRTUAL_CLOCK_STEP = 1.0;
+
+void TimeProviderRecord::setVirtualClock(unsigned int seed)
+{
+    m_virtualClock = true;
+
+    // Seeds select a second within a year, such that pages see a plausible date
+    m_virtualTime = VIRTUAL_CLOCK_EPOCH + (seed % (365 * 24 * 3600)) * 1000.0;
+}
+
 double TimeProviderRecord::currentTime()
 {
-    double time = JSC::TimeProviderDefault::currentTime();
+    double time;
+
+    if (m_virtualClock) {
+        time = m_virtualTime;
+        m_virtualTime += VIRTUAL_CLOCK_STEP;
+    } else {
+        time = JSC::TimeProviderDefault::currentTime();
+    }
+
     logTimeAccess(time);
 
     return time;
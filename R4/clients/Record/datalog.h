@@ -37,10 +37,22 @@ class TimeProviderRecord : public TimeProviderBase {
 public:
     TimeProviderRecord()
         : TimeProviderBase()
+        , m_virtualClock(false)
+        , m_virtualTime(0)
     {
     }
 
     double currentTime();
+
+    // Reduced variance record mode, time starts at a seeded point and advances by VIRTUAL_CLOCK_STEP ms on each access
+    void setVirtualClock(unsigned int seed);
+
+    static const double VIRTUAL_CLOCK_EPOCH; // ms, 2014-01-01 00:00 UTC
+    static const double VIRTUAL_CLOCK_STEP;
+
+private:
+    bool m_virtualClock;
+    double m_virtualTime;
 };
 
 class RandomProviderRecord : public RandomProviderBase {
@@ -42,12 +42,12 @@
 #include <WebCore/platform/ThreadGlobalData.h>
 #include <JavaScriptCore/runtime/JSExportMacros.h>
 #include <WebCore/platform/network/qt/QNetworkReplyHandler.h>
-#include <WebCore/platform/schedule/DefaultScheduler.h>
 #include <wtf/warningcollectorreport.h>
 
 #include "utils.h"
 #include "clientapplication.h"
 #include "specificationscheduler.h"
+#include "recordscheduler.h"
 #include "datalog.h"
 #include "autoexplorer.h"
 
@@ -55,7 +55,7 @@
 
 /**
  * () ->
- *  schedule.data log.network.data log.random.data log.time.data ER_actionlog errors.log record.png
+ *  schedule.data log.network.data log.random.data log.time.data log.latency.data ER_actionlog errors.log record.png
  */
 class RecordClientApplication : public ClientApplication {
     Q_OBJECT
@@ -80,11 +80,25 @@ private:
 
     bool m_showWindow;
 
+    // Network bodies are stored in this (shared) body store instead of the network log, if set
+    QString m_bodyStorePath;
+
+    // Reduced variance record mode (-reduced-variance <seed>), seeds time, random and the network release order. DOM
+    // timers still fire after wall-clock delays, thus recordings with the same seed are similar, not identical.
+    bool m_reducedVariance;
+    unsigned int m_seed;
+
     WebCore::QNetworkReplyControllableFactoryLive* m_network;
     TimeProviderRecord* m_timeProvider;
     RandomProviderRecord* m_randomProvider;
-    //SpecificationScheduler* m_scheduler;
-    WebCore::DefaultScheduler* m_scheduler;
+    RecordScheduler* m_scheduler;
+
+    // Replaces m_scheduler if set, with -specification-scheduler or -specification-policy <file>
+    bool m_useSpecificationScheduler;
+    SpecificationPolicy m_specificationPolicy;
+    SpecificationScheduler* m_specificationScheduler;
+    QString m_specificationTracePath; // decisions of m_specificationScheduler, see SpecificationScheduler::openTrace
+
     AutoExplorer* m_autoExplorer;
 
     QList<QNetworkCookie> mPresetCookies;
@@ -101,10 +115,13 @@ RecordClientApplication::RecordClientApplication(int& argc, char** argv)
     , m_autoExploreTimout(30)
     , m_autoExplore(false)
     , m_showWindow(true)
+    , m_reducedVariance(false)
+    , m_seed(0)
     , m_timeProvider(new TimeProviderRecord())
     , m_randomProvider(new RandomProviderRecord())
-    //, m_scheduler(new SpecificationScheduler(m_network))
-    , m_scheduler(new WebCore::DefaultScheduler())
+    , m_scheduler(new RecordScheduler())
+    , m_useSpecificationScheduler(false)
+    , m_specificationScheduler(0)
     , m_autoExplorer(new AutoExplorer(m_window, m_window->page()->mainFrame()))
 {
     QObject::connect(m_window, SIGNAL(sigOnCloseEvent()), this, SLOT(slOnCloseEvent()));
@@ -115,17 +132,58 @@ RecordClientApplication::RecordClientApplication(int& argc, char** argv)
     m_network = new WebCore::QNetworkReplyControllableFactoryLive();
     WebCore::QNetworkReplyControllableFactory::setFactory(m_network);
 
+    if (!m_bodyStorePath.isEmpty()) {
+        WebCore::QNetworkSnapshotBodyStore* bodyStore = new WebCore::QNetworkSnapshotBodyStore(m_bodyStorePath);
+
+        if (!bodyStore->isValid()) {
+            std::cerr << "Error: Could not open body store " << m_bodyStorePath.toStdString() << std::endl;
+            std::exit(1);
+        }
+
+        m_network->setBodyStore(bodyStore);
+    }
+
+    if (m_reducedVariance) {
+        m_network->setSeededRelease(m_seed);
+    }
+
+    // Snapshots are written as requests finish, snapshotState completes the network log and writes its index
+    QString outLogNetworkPath = m_outdir + "/log.network.data";
+    if (!m_network->streamNetworkFile(outLogNetworkPath)) {
+        std::cerr << "Error: Could not open " << outLogNetworkPath.toStdString() << " for writing" << std::endl;
+        std::exit(1);
+    }
+
     // Random
 
+    if (m_reducedVariance) {
+        m_randomProvider->setSeed(m_seed);
+    }
+
     m_randomProvider->attach();
 
     // Time
 
+    if (m_reducedVariance) {
+        m_timeProvider->setVirtualClock(m_seed);
+    }
+
     m_timeProvider->attach();
 
     // Scheduler
 
-    WebCore::ThreadTimers::setScheduler(m_scheduler);
+    if (m_useSpecificationScheduler) {
+        m_specificationScheduler = new SpecificationScheduler(m_network, m_specificationPolicy);
+
+        if (!m_specificationTracePath.isEmpty() && !m_specificationScheduler->openTrace(m_specificationTracePath)) {
+            std::cerr << "Error: Could not open " << m_specificationTracePath.toStdString() << " for writing" << std::endl;
+            std::exit(1);
+        }
+
+        WebCore::ThreadTimers::setScheduler(m_specificationScheduler);
+    } else {
+        WebCore::ThreadTimers::setScheduler(m_scheduler);
+    }
 
     // Cookies support
 
@@ -167,12 +225,19 @@ void RecordClientApplication::handleUserOptions()
                  << "[-autoexplore]"
                  << "[-autoexplore-timeout]"
                  << "[-pre-autoexplore-timeout]"
+                 << "[-autoexplore-quiescence <ms>]"
+                 << "[-autoexplore-policy fifo|novelty]"
                  << "[-hidewindow]"
                  << "[-verbose]"
                  << "[-proxy URL:PORT]"
                  << "[-cookie KEY=VALUE]"
                  << "[-ignore-mouse-move]"
                  << "[-out_dir]"
+                 << "[-body_store <dir>]"
+                 << "[-reduced-variance <seed>]"
+                 << "[-specification-scheduler]"
+                 << "[-specification-policy <file>]"
+                 << "[-specification-trace <file>]"
                  << "URL";
         std::exit(0);
     }
@@ -199,6 +264,24 @@ void RecordClientApplication::handleUserOptions()
 
     }
 
+    int bodyStoreIndex = args.indexOf("-body_store");
+    if (bodyStoreIndex != -1) {
+        m_bodyStorePath = takeOptionValue(&args, bodyStoreIndex);
+    }
+
+    int reducedVarianceIndex = args.indexOf("-reduced-variance");
+    if (reducedVarianceIndex != -1) {
+        bool ok;
+        m_seed = takeOptionValue(&args, reducedVarianceIndex).toUInt(&ok);
+
+        if (!ok) {
+            std::cerr << "Error: -reduced-variance requires an unsigned integer seed" << std::endl;
+            std::exit(1);
+        }
+
+        m_reducedVariance = true;
+    }
+
     int ignoreMouseMoveIndex = args.indexOf("-ignore-mouse-move");
     if (ignoreMouseMoveIndex != -1) {
         this->m_window->page()->ignoreMouseMove(true);
@@ -219,6 +302,47 @@ void RecordClientApplication::handleUserOptions()
         m_autoExplorePreTimout = takeOptionValue(&args, preTimeoutIndex).toInt();
     }
 
+    int quiescenceIndex = args.indexOf("-autoexplore-quiescence");
+    if (quiescenceIndex != -1) {
+        m_autoExplorer->setQuiescenceThreshold(takeOptionValue(&args, quiescenceIndex).toUInt());
+    }
+
+    int specificationSchedulerIndex = args.indexOf("-specification-scheduler");
+    if (specificationSchedulerIndex != -1) {
+        m_useSpecificationScheduler = true;
+    }
+
+    int specificationPolicyIndex = args.indexOf("-specification-policy");
+    if (specificationPolicyIndex != -1) {
+        QString policyPath = takeOptionValue(&args, specificationPolicyIndex);
+
+        QString error;
+        if (!m_specificationPolicy.load(policyPath, &error)) {
+            std::cerr << "Error: " << error.toStdString() << std::endl;
+            std::exit(1);
+        }
+
+        m_useSpecificationScheduler = true;
+    }
+
+    int specificationTraceIndex = args.indexOf("-specification-trace");
+    if (specificationTraceIndex != -1) {
+        m_specificationTracePath = takeOptionValue(&args, specificationTraceIndex);
+    }
+
+    int policyIndex = args.indexOf("-autoexplore-policy");
+    if (policyIndex != -1) {
+        QString policyName = takeOptionValue(&args, policyIndex);
+
+        EventAttachLog::Policy policy;
+        if (!EventAttachLog::StrPolicy(policyName.toAscii().data(), &policy)) {
+            std::cerr << "Error: Unknown auto exploration policy " << policyName.toStdString() << std::endl;
+            std::exit(1);
+        }
+
+        getEventAttachLog()->setPolicy(policy);
+    }
+
     int autoexploreIndex = args.indexOf("-autoexplore");
     if (autoexploreIndex != -1) {
         m_autoExplore = true;
@@ -263,6 +387,7 @@ void RecordClientApplication::snapshotState(QString id) {
     QString outLogNetworkPath = m_outdir + "/" + id + "log.network.data";
     QString outLogTimePath = m_outdir + "/" + id + "log.time.data";
     QString outLogRandomPath = m_outdir + "/" + id + "log.random.data";
+    QString outLogLatencyPath = m_outdir + "/" + id + "log.latency.data";
     QString outErLogPath = m_outdir + "/" + id + "ER_actionlog";
     QString logErrorsPath = m_outdir + "/" + id + "errors.log";
     QString screenshotPath = m_outdir + "/" + id + "screenshot.png";
@@ -297,12 +422,29 @@ void RecordClientApplication::snapshotState(QString id) {
 
     while (!queue.empty()) {
         QWebFrame* current = queue.takeFirst();
-        htmlHash += qHash(current->toHtml());
+        htmlHash += current->structuralHash();
         queue.append(current->childFrames());
     }
 
     statusfile << "HTML-hash: " << htmlHash << std::endl;
 
+    // The view of the ToolWindow (without menu and tool bar), headless replays use the same viewport
+    QSize viewport = m_window->page()->viewportSize();
+    statusfile << "Viewport-size: " << viewport.width() << "x" << viewport.height() << std::endl;
+
+    if (m_reducedVariance) {
+        statusfile << "Reduced-variance-seed: " << m_seed << std::endl;
+    }
+
+    if (m_useSpecificationScheduler) {
+        statusfile << "Scheduler-policy: " << m_specificationPolicy.description().toStdString() << std::endl;
+    }
+
+    if (m_autoExplore) {
+        // Exploration order, needed to reproduce this recording
+        statusfile << "Autoexplore-policy: " << getEventAttachLog()->policyDescription() << std::endl;
+    }
+
     statusfile.close();
 
     // happens before
@@ -324,6 +466,7 @@ void RecordClientApplication::snapshotState(QString id) {
 
     m_timeProvider->writeLogFile(outLogTimePath);
     m_randomProvider->writeLogFile(outLogRandomPath);
+    m_scheduler->latencyLog().writeLogFile(outLogLatencyPath);
 
     // Screenshot
 
@@ -360,6 +503,10 @@ void RecordClientApplication::slOnCloseEvent()
     arcslog.close();
 
     m_scheduler->stop();
+    if (m_specificationScheduler != 0) {
+        m_specificationScheduler->stop();
+    }
+
     m_window->close();
 
     std::cout << "Recording finished" << std::endl;
@@ -9,11 +9,13 @@ include(../BaseClient/baseclient.pri)
 SOURCES += \
     main.cpp \
     specificationscheduler.cpp \
+    recordscheduler.cpp \
     datalog.cpp \
     autoexplorer.cpp
 
 HEADERS += \
     specificationscheduler.h \
+    recordscheduler.h \
     autoexplorer.h \
     datalog.h
 
@@ -0,0 +1,58 @@
+/*
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "platform/schedule/EventActionRegister.h"
+
+#include "recordscheduler.h"
+
+RecordScheduler::RecordScheduler()
+    : Scheduler()
+    , m_stopped(false)
+    , m_previousEnd(0)
+{
+    m_clock.start();
+}
+
+RecordScheduler::~RecordScheduler()
+{
+}
+
+void RecordScheduler::eventActionScheduled(const WTF::EventActionDescriptor& descriptor,
+                                           WebCore::EventActionRegister* eventActionRegister)
+{
+    if (m_stopped) {
+        return;
+    }
+
+    // Event actions which became available while the previous one was running could be executed right away
+    qint64 available = m_clock.elapsed();
+    m_latencyLog.append(QString::fromAscii(descriptor.getType()), (quint32)std::max<qint64>(0, available - m_previousEnd));
+
+    if (eventActionRegister->runEventAction(descriptor)) {
+        m_previousEnd = m_clock.elapsed();
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RECORDSCHEDULER_H
+#define RECORDSCHEDULER_H
+
+#include <QElapsedTimer>
+
+#include <wtf/ExportMacros.h>
+#include <WebCore/platform/schedule/Scheduler.h>
+
+#include "basedatalog.h"
+
+/**
+ * Executes event actions as soon as they are scheduled (as the DefaultScheduler), and records the scheduling latency
+ * of each event action by descriptor type.
+ *
+ * WebERA: Immediate event actions bypass the scheduler, thus they are neither sampled nor counted as the previous event action.
+ */
+class RecordScheduler : public WebCore::Scheduler
+{
+
+public:
+    RecordScheduler();
+    ~RecordScheduler();
+
+    void eventActionScheduled(const WTF::EventActionDescriptor& descriptor, WebCore::EventActionRegister* eventActionRegister);
+    void eventActionDescheduled(const WTF::EventActionDescriptor&, WebCore::EventActionRegister*) {}
+    void executeDelayedEventActions(WebCore::EventActionRegister*) {}
+
+    void stop() {
+        m_stopped = true;
+    }
+
+    const LatencyLog& latencyLog() const {
+        return m_latencyLog;
+    }
+
+private:
+    bool m_stopped;
+
+    QElapsedTimer m_clock;
+    qint64 m_previousEnd; // end of the previous event action, miliseconds on m_clock
+
+    LatencyLog m_latencyLog;
+};
+
+#endif // RECORDSCHEDULER_H
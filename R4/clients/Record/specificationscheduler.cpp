@@ -27,13 +27,255 @@
 #include <cstdlib>
 #include <iostream>
 
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+#include <QTextStream>
+
 #include "platform/schedule/EventActionRegister.h"
 
 #include "specificationscheduler.h"
 
-SpecificationScheduler::SpecificationScheduler(WebCore::QNetworkReplyControllableFactory* network)
+SpecificationPolicy::SpecificationPolicy()
+{
+    Queue parsing;
+    parsing.name = "parsing";
+    parsing.types.insert("HTMLDocumentParser");
+
+    Queue network;
+    network.name = "network";
+    network.types.insert("Network");
+    network.finishSequences = true;
+
+    Queue other;
+    other.name = "other";
+    other.matchAll = true;
+
+    m_queues << parsing << network << other;
+    m_matchOrder << 0 << 1 << 2;
+}
+
+bool SpecificationPolicy::load(const QString& path, QString* error)
+{
+    QFile fp(path);
+    if (!fp.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *error = "Could not open " + path;
+        return false;
+    }
+
+    QList<Queue> queues; // in file order
+    QStringList order;
+
+    QTextStream in(&fp);
+    int lineNumber = 0;
+
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        ++lineNumber;
+
+        int comment = line.indexOf('#');
+        if (comment != -1) {
+            line = line.left(comment);
+        }
+
+        QStringList tokens = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if (tokens.isEmpty()) {
+            continue;
+        }
+
+        QString where = path + ":" + QString::number(lineNumber) + ": ";
+        QString directive = tokens.takeFirst();
+
+        if (directive == "queue") {
+
+            if (tokens.isEmpty()) {
+                *error = where + "queue without a name";
+                return false;
+            }
+
+            Queue queue;
+            queue.name = tokens.takeFirst();
+
+            foreach (const Queue& existing, queues) {
+                if (existing.name == queue.name) {
+                    *error = where + "duplicate queue " + queue.name;
+                    return false;
+                }
+            }
+
+            if (!tokens.isEmpty() && tokens.first() == "finish-sequences") {
+                queue.finishSequences = true;
+                tokens.removeFirst();
+            }
+
+            if (tokens.isEmpty()) {
+                *error = where + "queue " + queue.name + " matches nothing";
+                return false;
+            }
+
+            foreach (const QString& match, tokens) {
+                if (match == "*") {
+                    queue.matchAll = true;
+                } else if (match == "@OTHER") {
+                    queue.categories.insert(WTF::OTHER);
+                } else if (match == "@TIMER") {
+                    queue.categories.insert(WTF::TIMER);
+                } else if (match == "@USER_INTERFACE") {
+                    queue.categories.insert(WTF::USER_INTERFACE);
+                } else if (match == "@NETWORK") {
+                    queue.categories.insert(WTF::NETWORK);
+                } else if (match == "@PARSING") {
+                    queue.categories.insert(WTF::PARSING);
+                } else if (match.startsWith('@')) {
+                    *error = where + "unknown category " + match;
+                    return false;
+                } else {
+                    queue.types.insert(match);
+                }
+            }
+
+            queues.append(queue);
+
+        } else if (directive == "order") {
+
+            if (!order.isEmpty()) {
+                *error = where + "duplicate order";
+                return false;
+            }
+
+            order = tokens;
+
+        } else {
+            *error = where + "unknown directive " + directive;
+            return false;
+        }
+    }
+
+    if (queues.isEmpty()) {
+        *error = path + ": no queues";
+        return false;
+    }
+
+    if (order.isEmpty()) {
+        foreach (const Queue& queue, queues) {
+            order.append(queue.name);
+        }
+    }
+
+    if (order.size() != queues.size()) {
+        *error = path + ": order must list every queue exactly once";
+        return false;
+    }
+
+    QList<Queue> prioritized;
+    QList<int> matchOrder;
+
+    foreach (const QString& name, order) {
+        bool found = false;
+
+        for (int i = 0; i < queues.size(); ++i) {
+            if (queues.at(i).name == name) {
+                prioritized.append(queues.at(i));
+                found = true;
+                break;
+            }
+        }
+
+        if (!found || order.count(name) != 1) {
+            *error = path + ": order must list every queue exactly once";
+            return false;
+        }
+    }
+
+    foreach (const Queue& queue, queues) {
+        matchOrder.append(order.indexOf(queue.name));
+    }
+
+    m_queues = prioritized;
+    m_matchOrder = matchOrder;
+    m_queueByType.clear();
+
+    return true;
+}
+
+int SpecificationPolicy::queueFor(const WTF::EventActionDescriptor& descriptor) const
+{
+    QString type = QString::fromAscii(descriptor.getType());
+    QString cacheKey = QString::number(descriptor.getCategory()) + ":" + type;
+
+    QHash<QString, int>::const_iterator cached = m_queueByType.find(cacheKey);
+    if (cached != m_queueByType.end()) {
+        return *cached;
+    }
+
+    int result = m_matchOrder.last();
+
+    foreach (int index, m_matchOrder) {
+        const Queue& queue = m_queues.at(index);
+
+        if (queue.matchAll || queue.types.contains(type) || queue.categories.contains(descriptor.getCategory())) {
+            result = index;
+            break;
+        }
+    }
+
+    m_queueByType.insert(cacheKey, result);
+    return result;
+}
+
+QString SpecificationPolicy::description() const
+{
+    QStringList queues;
+
+    foreach (const Queue& queue, m_queues) {
+        queues.append(queue.finishSequences ? queue.name + " (finish-sequences)" : queue.name);
+    }
+
+    return queues.join(" > ");
+}
+
+void SpecificationScheduler::EntryList::append(Entry* entry)
+{
+    entry->previous = m_tail;
+    entry->next = 0;
+    entry->list = this;
+
+    if (m_tail != 0) {
+        m_tail->next = entry;
+    } else {
+        m_head = entry;
+    }
+
+    m_tail = entry;
+}
+
+void SpecificationScheduler::EntryList::remove(Entry* entry)
+{
+    ASSERT(entry->list == this);
+
+    if (entry->previous != 0) {
+        entry->previous->next = entry->next;
+    } else {
+        m_head = entry->next;
+    }
+
+    if (entry->next != 0) {
+        entry->next->previous = entry->previous;
+    } else {
+        m_tail = entry->previous;
+    }
+
+    entry->previous = 0;
+    entry->next = 0;
+    entry->list = 0;
+}
+
+SpecificationScheduler::SpecificationScheduler(WebCore::QNetworkReplyControllableFactory* network, const SpecificationPolicy& policy)
     : QObject(NULL)
     , Scheduler()
+    , m_policy(policy)
+    , m_queues(policy.queueCount())
+    , m_nextOrder(0)
     , m_network(network)
     , m_stopped(false)
 {
@@ -41,65 +283,105 @@ SpecificationScheduler::SpecificationScheduler(WebCore::QNetworkReplyControllabl
 
 SpecificationScheduler::~SpecificationScheduler()
 {
+    qDeleteAll(m_entriesByKey);
 }
 
-void SpecificationScheduler::eventActionScheduled(const WTF::EventActionDescriptor& descriptor,
-                                                  WebCore::EventActionRegister*)
+void SpecificationScheduler::stop()
 {
-    if (strcmp(descriptor.getType(), "HTMLDocumentParser") == 0) {
-        m_parsingQueue.push(descriptor);
-    } else if (strcmp(descriptor.getType(), "Network") == 0) {
+    m_stopped = true;
 
-        std::string networkSeqId = getNetworkSequenceId(descriptor);
+    if (m_trace.isOpen()) {
+        m_trace.flush();
+    }
+}
 
-        if (m_activeNetworkEvents.find(networkSeqId) == m_activeNetworkEvents.end()) {
-            m_networkQueue.push(descriptor);
-        } else {
-            m_activeNetworkQueue.push(descriptor);
-        }
+bool SpecificationScheduler::openTrace(const QString& path)
+{
+    m_trace.setFileName(path);
+    return m_trace.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
 
-    } else {
-        m_otherQueue.push(descriptor);
+void SpecificationScheduler::trace(const char* decision, const QString& key)
+{
+    if (!m_trace.isOpen()) {
+        return;
     }
+
+    m_trace.write(decision);
+    m_trace.write(";");
+    m_trace.write(key.toUtf8());
+    m_trace.write("\n");
 }
 
-void dequeueSpecificElement(const WTF::EventActionDescriptor& descriptor,
-                            std::queue<WTF::EventActionDescriptor>* queue)
+QString SpecificationScheduler::getNetworkSequenceId(const WTF::EventActionDescriptor& descriptor)
 {
-    std::queue<WTF::EventActionDescriptor> old;
-    std::swap(*queue, old);
+    return QString::fromStdString(descriptor.getParameter(0) + "," + descriptor.getParameter(1)); // url,url-sequence-number
+}
 
-    while (!old.empty()) {
-        if (old.front() != descriptor) {
-            queue->push(old.front());
-        }
+void SpecificationScheduler::eventActionScheduled(const WTF::EventActionDescriptor& descriptor,
+                                                  WebCore::EventActionRegister*)
+{
+    Entry* entry = new Entry();
+    entry->descriptor = descriptor;
+    entry->key = QString::fromStdString(descriptor.toString());
+    entry->order = m_nextOrder++;
+
+    if (strcmp(descriptor.getType(), "Network") == 0) {
+        entry->sequence = getNetworkSequenceId(descriptor);
+        m_entriesBySequence.insert(entry->sequence, entry);
+    }
+
+    m_entriesByKey.insert(entry->key, entry);
+    trace("scheduled", entry->key);
 
-        old.pop();
+    if (!entry->sequence.isEmpty() && m_activeNetworkEvents.contains(entry->sequence)) {
+        m_activeNetworkQueue.append(entry);
+    } else {
+        m_queues[m_policy.queueFor(descriptor)].append(entry);
     }
 }
 
 void SpecificationScheduler::eventActionDescheduled(const WTF::EventActionDescriptor& descriptor,
                                                     WebCore::EventActionRegister*)
 {
+    QString key = QString::fromStdString(descriptor.toString());
+    trace("descheduled", key);
 
-    if (strcmp(descriptor.getType(), "HTMLDocumentParser") == 0) {
+    foreach (Entry* entry, m_entriesByKey.values(key)) {
+        removeEntry(entry);
+    }
+}
 
-        dequeueSpecificElement(descriptor, &m_parsingQueue);
+void SpecificationScheduler::removeEntry(Entry* entry)
+{
+    entry->list->remove(entry);
 
-    } else if (strcmp(descriptor.getType(), "NETWORK") == 0) {
+    m_entriesByKey.remove(entry->key, entry);
 
-        std::string networkSeqId = getNetworkSequenceId(descriptor);
+    if (!entry->sequence.isEmpty()) {
+        m_entriesBySequence.remove(entry->sequence, entry);
+    }
 
-        if (m_activeNetworkEvents.find(networkSeqId) == m_activeNetworkEvents.end()) {
-            dequeueSpecificElement(descriptor, &m_networkQueue);
-        } else {
-            dequeueSpecificElement(descriptor, &m_activeNetworkQueue);
-        }
+    delete entry;
+}
 
-    } else {
-        dequeueSpecificElement(descriptor, &m_otherQueue);
+void SpecificationScheduler::activateSequence(const QString& sequence)
+{
+    m_activeNetworkEvents.insert(sequence);
+
+    // Move the waiting event actions of this network request to the active queue, keeping them in schedule order
+    QList<Entry*> entries = m_entriesBySequence.values(sequence);
+
+    for (int i = 1; i < entries.size(); ++i) {
+        for (int j = i; j > 0 && entries.at(j)->order < entries.at(j - 1)->order; --j) {
+            entries.swap(j, j - 1);
+        }
     }
 
+    foreach (Entry* entry, entries) {
+        entry->list->remove(entry);
+        m_activeNetworkQueue.append(entry);
+    }
 }
 
 void SpecificationScheduler::executeDelayedEventActions(WebCore::EventActionRegister* eventActionRegister)
@@ -109,6 +391,44 @@ void SpecificationScheduler::executeDelayedEventActions(WebCore::EventActionRegi
     }
 }
 
+bool SpecificationScheduler::runFront(EntryList* list, WebCore::EventActionRegister* eventActionRegister, bool* lastInSequence)
+{
+    // Copied, the event action can schedule and deschedule other event actions (including itself) while running
+    WTF::EventActionDescriptor descriptor = list->front()->descriptor;
+    QString key = list->front()->key;
+    bool inSequence = !list->front()->sequence.isEmpty();
+
+    unsigned int currentFinishedNetworkJobs = m_network->doneCounter();
+
+    trace("picked", key);
+
+    if (!eventActionRegister->runEventAction(descriptor)) {
+        trace("not-executed", key);
+        return false;
+    }
+
+    trace("executed", key);
+
+    // The last network event action of a request has ULONG_MAX as its sequence number, or finishes the request
+    if (inSequence) {
+        *lastInSequence = strtoul(descriptor.getParameter(2).c_str(), NULL, 0) == ULONG_MAX ||
+                m_network->doneCounter() > currentFinishedNetworkJobs;
+    }
+
+    Entry* executed = 0;
+    foreach (Entry* entry, m_entriesByKey.values(key)) {
+        if (executed == 0 || entry->order < executed->order) {
+            executed = entry;
+        }
+    }
+
+    if (executed != 0) {
+        removeEntry(executed);
+    }
+
+    return true;
+}
+
 bool SpecificationScheduler::executeDelayedEventAction(WebCore::EventActionRegister *eventActionRegister)
 {
     if (m_stopped) {
@@ -120,19 +440,12 @@ bool SpecificationScheduler::executeDelayedEventAction(WebCore::EventActionRegis
 
         if (!m_activeNetworkQueue.empty()) {
 
-            WTF::EventActionDescriptor descriptor = m_activeNetworkQueue.front();
-            unsigned int currentFinishedNetworkJobs = m_network->doneCounter();
-
-            if (eventActionRegister->runEventAction(descriptor)) {
-                m_activeNetworkQueue.pop();
+            QString sequence = m_activeNetworkQueue.front()->sequence;
+            bool lastInSequence = false;
 
-                if (strtoul(descriptor.getParameter(2).c_str(), NULL, 0) == ULONG_MAX ||
-                        m_network->doneCounter() > currentFinishedNetworkJobs) {
-                    // this was the last element in the sequence, remove it from the active events
-
-                    std::string id = getNetworkSequenceId(descriptor);
-                    m_activeNetworkEvents.erase(id);
-                }
+            if (runFront(&m_activeNetworkQueue, eventActionRegister, &lastInSequence) && lastInSequence) {
+                // this was the last element in the sequence, remove it from the active events
+                m_activeNetworkEvents.remove(sequence);
             }
 
         }
@@ -140,57 +453,26 @@ bool SpecificationScheduler::executeDelayedEventAction(WebCore::EventActionRegis
         return false;
     }
 
-    if (!m_parsingQueue.empty()) {
+    // The first non-empty queue (in policy order) runs next
+    for (int i = 0; i < m_queues.size(); ++i) {
 
-        if (eventActionRegister->runEventAction(m_parsingQueue.front())) {
-            m_parsingQueue.pop();
-            return true;
+        if (m_queues[i].empty()) {
+            continue;
         }
 
-    } else if (!m_networkQueue.empty()) {
-
-        WTF::EventActionDescriptor descriptor = m_networkQueue.front();
-        unsigned int currentFinishedNetworkJobs = m_network->doneCounter();
-
-        if (eventActionRegister->runEventAction(descriptor)) {
-
-            m_networkQueue.pop();
+        QString sequence = m_queues[i].front()->sequence;
+        bool lastInSequence = true;
 
-            if (strtoul(descriptor.getParameter(2).c_str(), NULL, 0) != ULONG_MAX &&
-                    currentFinishedNetworkJobs == m_network->doneCounter()) {
-                // this is not the last element in the sequence
-
-                std::string id = getNetworkSequenceId(descriptor);
-
-                // add to active event actions
-                m_activeNetworkEvents.insert(id);
-
-                // split the exiting network event queue into active and non-active events
-                std::queue<WTF::EventActionDescriptor> currentQueue;
-                std::swap(currentQueue, m_networkQueue);
-
-                while (!currentQueue.empty()) {
-                    WTF::EventActionDescriptor existingEvent = currentQueue.front();
-                    currentQueue.pop();
-
-                    std::string existingEventId = getNetworkSequenceId(existingEvent); // url,url-sequence-number
-
-                    if (id == existingEventId) {
-                        m_activeNetworkQueue.push(existingEvent);
-                    } else {
-                        m_networkQueue.push(existingEvent);
-                    }
-                }
-            }
-
-            return true;
+        if (!runFront(&m_queues[i], eventActionRegister, &lastInSequence)) {
+            return false;
         }
 
-    } else if (!m_otherQueue.empty()) {
-        if (eventActionRegister->runEventAction(m_otherQueue.front())) {
-            m_otherQueue.pop();
-            return true;
+        if (m_policy.finishesSequences(i) && !sequence.isEmpty() && !lastInSequence) {
+            // this is not the last element in the sequence, the remaining elements run before anything else
+            activateSequence(sequence);
         }
+
+        return true;
     }
 
     return false;
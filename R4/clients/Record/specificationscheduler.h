@@ -24,9 +24,12 @@
  */
 
 #include <QObject>
-
-#include <queue>
-#include <set>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
 
 #include <wtf/ExportMacros.h>
 #include <WebCore/platform/Timer.h>
@@ -40,41 +43,158 @@
 #ifndef SPECIFICATION_SCHEDULER_H
 #define SPECIFICATION_SCHEDULER_H
 
+/**
+ * Ordering rules of the SpecificationScheduler, read from a policy file (see policies/ for examples).
+ *
+ *   # comment
+ *   queue <name> [finish-sequences] <match>...
+ *   order <name>...
+ *
+ * Each event action is put in the first queue (in file order) with a matching descriptor type (e.g. Network), category
+ * (@OTHER, @TIMER, @USER_INTERFACE, @NETWORK or @PARSING) or *. Event actions matching no queue are put in the last
+ * queue. Queues are served in the given order, defaulting to file order, and each queue in FIFO order.
+ *
+ * Once the first event action of a network request (Network descriptor) in a finish-sequences queue has executed, the
+ * remaining event actions of that request are executed before anything else.
+ *
+ * The default policy executes parsing before network, and network before everything else.
+ */
+class SpecificationPolicy
+{
+
+public:
+    SpecificationPolicy();
+
+    bool load(const QString& path, QString* error);
+
+    int queueCount() const {
+        return m_queues.size();
+    }
+
+    const QString& queueName(int queue) const {
+        return m_queues.at(queue).name;
+    }
+
+    bool finishesSequences(int queue) const {
+        return m_queues.at(queue).finishSequences;
+    }
+
+    // Index of the queue of descriptor, queues are indexed in priority order
+    int queueFor(const WTF::EventActionDescriptor& descriptor) const;
+
+    QString description() const;
+
+private:
+    struct Queue {
+        Queue()
+            : matchAll(false)
+            , finishSequences(false)
+        {
+        }
+
+        QString name;
+        QSet<QString> types;
+        QSet<int> categories;
+        bool matchAll;
+        bool finishSequences;
+    };
+
+    QList<Queue> m_queues;     // in priority order
+    QList<int> m_matchOrder;   // indices into m_queues, in file order
+
+    mutable QHash<QString, int> m_queueByType; // category and type -> queue
+};
+
 class SpecificationScheduler : public QObject, public WebCore::Scheduler
 {
     Q_OBJECT
 
 public:
-    SpecificationScheduler(WebCore::QNetworkReplyControllableFactory* network);
+    SpecificationScheduler(WebCore::QNetworkReplyControllableFactory* network, const SpecificationPolicy& policy = SpecificationPolicy());
     ~SpecificationScheduler();
 
     void eventActionScheduled(const WTF::EventActionDescriptor& descriptor, WebCore::EventActionRegister* eventActionRegister);
     void eventActionDescheduled(const WTF::EventActionDescriptor& descriptor, WebCore::EventActionRegister* eventActionRegister);
     void executeDelayedEventActions(WebCore::EventActionRegister* eventActionRegister);
 
-    void stop() {
-        m_stopped = true;
-    }
+    void stop();
+
+    /**
+     * Write the decisions of the scheduler to path, one per line as <decision>;<descriptor>, read by
+     * utils/check-policies.py. Decisions are scheduled, descheduled, picked (about to run), and then executed or
+     * not-executed (no handler took it). Event actions scheduled while a picked event action runs follow its picked line.
+     */
+    bool openTrace(const QString& path);
 
 private:
 
+    /**
+     * Waiting event actions are linked into exactly one queue, and indexed by descriptor and network request such that
+     * descheduling and activating a network request does not have to walk the queues.
+     */
+    class EntryList;
+
+    struct Entry {
+        WTF::EventActionDescriptor descriptor;
+        QString key;      // descriptor string
+        QString sequence; // network request, empty if the event action is not part of a network request
+        unsigned int order;
+
+        Entry* previous;
+        Entry* next;
+        EntryList* list;
+    };
+
+    class EntryList {
+    public:
+        EntryList()
+            : m_head(0)
+            , m_tail(0)
+        {
+        }
+
+        bool empty() const {
+            return m_head == 0;
+        }
+
+        Entry* front() const {
+            return m_head;
+        }
+
+        void append(Entry* entry);
+        void remove(Entry* entry);
+
+    private:
+        Entry* m_head;
+        Entry* m_tail;
+    };
+
     bool executeDelayedEventAction(WebCore::EventActionRegister* eventActionRegister);
+    bool runFront(EntryList* list, WebCore::EventActionRegister* eventActionRegister, bool* lastInSequence);
 
-    std::string getNetworkSequenceId(const WTF::EventActionDescriptor& descriptor) const {
-        return descriptor.getParameter(0) + "," + descriptor.getParameter(1);
-    }
+    void removeEntry(Entry* entry);
+    void activateSequence(const QString& sequence);
+
+    static QString getNetworkSequenceId(const WTF::EventActionDescriptor& descriptor);
 
-    std::set<std::string> m_activeNetworkEvents;
+    void trace(const char* decision, const QString& key);
 
-    std::queue<WTF::EventActionDescriptor> m_activeNetworkQueue;
-    std::queue<WTF::EventActionDescriptor> m_parsingQueue;
-    std::queue<WTF::EventActionDescriptor> m_networkQueue;
-    std::queue<WTF::EventActionDescriptor> m_otherQueue;
+    SpecificationPolicy m_policy;
+
+    QVector<EntryList> m_queues; // by policy queue
+    EntryList m_activeNetworkQueue;
+    QSet<QString> m_activeNetworkEvents;
+
+    QMultiHash<QString, Entry*> m_entriesByKey;
+    QMultiHash<QString, Entry*> m_entriesBySequence;
+    unsigned int m_nextOrder;
 
     WebCore::QNetworkReplyControllableFactory* m_network;
 
     bool m_stopped;
 
+    QFile m_trace;
+
 };
 
 #endif // SPECIFICATION_SCHEDULER_H
@@ -0,0 +1,132 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+
+#include <QFile>
+#include <QMutexLocker>
+
+#include "artifactwriter.h"
+
+ArtifactWriter::ArtifactWriter(int maxQueued, QObject* parent)
+    : QThread(parent)
+    , m_maxQueued(maxQueued)
+{
+}
+
+ArtifactWriter::~ArtifactWriter()
+{
+    finish();
+}
+
+void ArtifactWriter::writeData(const QString& path, const QByteArray& data)
+{
+    Artifact artifact;
+    artifact.path = path;
+    artifact.data = data;
+    artifact.isImage = false;
+    artifact.isLast = false;
+
+    enqueue(artifact);
+}
+
+void ArtifactWriter::writeImage(const QString& path, const QImage& image)
+{
+    Artifact artifact;
+    artifact.path = path;
+    artifact.image = image;
+    artifact.isImage = true;
+    artifact.isLast = false;
+
+    enqueue(artifact);
+}
+
+void ArtifactWriter::finish()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    Artifact last;
+    last.isImage = false;
+    last.isLast = true;
+
+    enqueue(last);
+    wait();
+}
+
+void ArtifactWriter::enqueue(const Artifact& artifact)
+{
+    if (!isRunning() && !artifact.isLast) {
+        start();
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    while (m_queue.size() >= m_maxQueued) {
+        m_notFull.wait(&m_mutex);
+    }
+
+    m_queue.enqueue(artifact);
+    m_notEmpty.wakeOne();
+}
+
+void ArtifactWriter::run()
+{
+    while (true) {
+        Artifact artifact;
+
+        {
+            QMutexLocker locker(&m_mutex);
+
+            while (m_queue.isEmpty()) {
+                m_notEmpty.wait(&m_mutex);
+            }
+
+            artifact = m_queue.dequeue();
+            m_notFull.wakeOne();
+        }
+
+        if (artifact.isLast) {
+            return;
+        }
+
+        if (artifact.isImage) {
+            if (!artifact.image.save(artifact.path)) {
+                std::cerr << "Warning: Could not write " << artifact.path.toStdString() << std::endl;
+            }
+
+            continue;
+        }
+
+        QFile fp(artifact.path);
+        if (!fp.open(QIODevice::WriteOnly | QIODevice::Truncate) || fp.write(artifact.data) != artifact.data.size()) {
+            std::cerr << "Warning: Could not write " << artifact.path.toStdString() << std::endl;
+        }
+
+        fp.close();
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARTIFACTWRITER_H
+#define ARTIFACTWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QString>
+#include <QByteArray>
+#include <QImage>
+
+/**
+ * Writes replay artifacts (output files) on a background thread.
+ *
+ * Artifacts are captured on the GUI thread (the page, ActionLog and scheduler state all belong to it), and only the
+ * encoding and writing to disk is done by the writer. The queue is bounded, enqueueing blocks if the writer falls behind.
+ *
+ * The writer thread is started on the first enqueue, such that it is never running when the fork-server forks.
+ */
+class ArtifactWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    ArtifactWriter(int maxQueued = 4, QObject* parent = 0);
+    ~ArtifactWriter();
+
+    void writeData(const QString& path, const QByteArray& data);
+    void writeImage(const QString& path, const QImage& image);
+
+    // Blocks until all enqueued artifacts are written
+    void finish();
+
+protected:
+    void run();
+
+private:
+    struct Artifact {
+        QString path;
+        QByteArray data;
+        QImage image;
+        bool isImage;
+        bool isLast;
+    };
+
+    void enqueue(const Artifact& artifact);
+
+    QQueue<Artifact> m_queue;
+    int m_maxQueued;
+
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+};
+
+#endif // ARTIFACTWRITER_H
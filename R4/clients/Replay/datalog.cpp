@@ -39,10 +39,18 @@
 TimeProviderReplay::TimeProviderReplay(QString logPath)
     : TimeProviderBase()
     , m_mode(STRICT)
+    , m_hasCurrent(false)
+    , m_current(-1)
 {
     deserialize(logPath);
 }
 
+void TimeProviderReplay::setCurrentDescriptorString(QString ident)
+{
+    m_hasCurrent = true;
+    m_current = m_in_log.indexOf(ident);
+}
+
 double TimeProviderReplay::currentTime()
 {
 
@@ -53,7 +61,7 @@ double TimeProviderReplay::currentTime()
         return time;
     }
 
-    if (m_currentDescriptorString.isNull()) {
+    if (!m_hasCurrent) {
         std::cerr << "Error: Time requested by non-schedulable event action." << std::endl;
         std::exit(1);
 
@@ -61,9 +69,7 @@ double TimeProviderReplay::currentTime()
         return time;
     }
 
-    Log::iterator iter = m_in_log.find(m_currentDescriptorString);
-
-    if (iter == m_in_log.end() || iter->isEmpty()) {
+    if (m_current == -1 || m_cursors[m_current] == m_in_log.entries(m_current).size()) {
 
         if (m_mode == BEST_EFFORT || m_mode == BEST_EFFORT_NOND) {
             WTF::WarningCollectorReport("WEBERA_TIME_DATA", "New access to the time API in best effort mode.", "");
@@ -79,7 +85,7 @@ double TimeProviderReplay::currentTime()
         return time;
     }
 
-    time = iter->takeFirst();
+    time = m_in_log.entries(m_current).at(m_cursors[m_current]++);
     logTimeAccess(time);
     return time;
 }
@@ -92,18 +98,35 @@ void TimeProviderReplay::deserialize(QString path)
     ASSERT(fp.isOpen());
 
     QDataStream in(&fp);
-    in >> m_in_log;
+
+    if (readDataLogHeader(in)) {
+        m_in_log.read(in);
+    } else {
+        m_in_log.readLegacy(in);
+    }
 
     fp.close();
+
+    m_cursors.fill(0, m_in_log.size());
 }
 
 RandomProviderReplay::RandomProviderReplay(QString logPath)
     : RandomProviderBase()
     , m_mode(STRICT)
+    , m_hasCurrent(false)
+    , m_current_double(-1)
+    , m_current_unsigned(-1)
 {
     deserialize(logPath);
 }
 
+void RandomProviderReplay::setCurrentDescriptorString(QString ident)
+{
+    m_hasCurrent = true;
+    m_current_double = m_in_double_log.indexOf(ident);
+    m_current_unsigned = m_in_unsigned_log.indexOf(ident);
+}
+
 double RandomProviderReplay::get()
 {
 
@@ -114,7 +137,7 @@ double RandomProviderReplay::get()
         return random;
     }
 
-    if (m_currentDescriptorString.isNull()) {
+    if (!m_hasCurrent) {
         std::cerr << "Error: Random number requested by non-schedulable event action." << std::endl;
         std::exit(1);
 
@@ -122,9 +145,7 @@ double RandomProviderReplay::get()
         return random;
     }
 
-    DLog::iterator iter = m_in_double_log.find(m_currentDescriptorString);
-
-    if (iter == m_in_double_log.end() || iter->isEmpty()) {
+    if (m_current_double == -1 || m_double_cursors[m_current_double] == m_in_double_log.entries(m_current_double).size()) {
 
         if (m_mode == BEST_EFFORT || m_mode == BEST_EFFORT_NOND) {
             WTF::WarningCollectorReport("WEBERA_RANDOM_DATA", "New access to the random API in best effort mode.", "");
@@ -139,7 +160,7 @@ double RandomProviderReplay::get()
         return random;
     }
 
-    random = iter->takeFirst();
+    random = m_in_double_log.entries(m_current_double).at(m_double_cursors[m_current_double]++);
     logRandomAccess(random);
     return random;
 }
@@ -154,7 +175,7 @@ unsigned RandomProviderReplay::getUint32()
         return random;
     }
 
-    if (m_currentDescriptorString.isNull()) {
+    if (!m_hasCurrent) {
         std::cerr << "Error: Random number requested by non-schedulable event action." << std::endl;
         std::exit(1);
 
@@ -162,9 +183,7 @@ unsigned RandomProviderReplay::getUint32()
         return random;
     }
 
-    ULog::iterator iter = m_in_unsigned_log.find(m_currentDescriptorString);
-
-    if (iter == m_in_unsigned_log.end() || iter->isEmpty()) {
+    if (m_current_unsigned == -1 || m_unsigned_cursors[m_current_unsigned] == m_in_unsigned_log.entries(m_current_unsigned).size()) {
 
         if (m_mode == BEST_EFFORT || m_mode == BEST_EFFORT_NOND) {
             WTF::WarningCollectorReport("WEBERA_RANDOM_DATA", "New access to the random API in best effort mode.", "");
@@ -179,7 +198,7 @@ unsigned RandomProviderReplay::getUint32()
         return random;
     }
 
-    random = iter->takeFirst();
+    random = m_in_unsigned_log.entries(m_current_unsigned).at(m_unsigned_cursors[m_current_unsigned]++);
     logRandomAccessUint32(random);
     return random;
 }
@@ -192,8 +211,17 @@ void RandomProviderReplay::deserialize(QString path)
     ASSERT(fp.isOpen());
 
     QDataStream in(&fp);
-    in >> m_in_double_log;
-    in >> m_in_unsigned_log;
+
+    if (readDataLogHeader(in)) {
+        m_in_double_log.read(in);
+        m_in_unsigned_log.read(in);
+    } else {
+        m_in_double_log.readLegacy(in);
+        m_in_unsigned_log.readLegacy(in);
+    }
 
     fp.close();
+
+    m_double_cursors.fill(0, m_in_double_log.size());
+    m_unsigned_cursors.fill(0, m_in_unsigned_log.size());
 }
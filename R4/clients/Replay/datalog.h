@@ -31,6 +31,7 @@
 
 #include <QHash>
 #include <QList>
+#include <QVector>
 
 #include "basedatalog.h"
 
@@ -43,12 +44,12 @@ public:
 
     double currentTime();
 
-    void setCurrentDescriptorString(QString ident) {
-        m_currentDescriptorString = ident;
-    }
+    // Resolves the log entries (and read cursor) of the event action once, before it is executed
+    void setCurrentDescriptorString(QString ident);
 
     void unsetCurrentDescriptorString() {
-        m_currentDescriptorString = QString();
+        m_hasCurrent = false;
+        m_current = -1;
     }
 
     void setMode(ReplayMode value) {
@@ -59,9 +60,11 @@ private:
     void deserialize(QString logPath);
 
     Log m_in_log;
+    QVector<int> m_cursors; // next entry to read, for each descriptor in m_in_log
 
     ReplayMode m_mode;
-    QString m_currentDescriptorString;
+    bool m_hasCurrent;
+    int m_current; // index of the current descriptor in m_in_log, -1 if it is not in the log
 };
 
 class RandomProviderReplay : public RandomProviderBase {
@@ -72,12 +75,13 @@ public:
     double get();
     unsigned getUint32();
 
-    void setCurrentDescriptorString(QString ident) {
-        m_currentDescriptorString = ident;
-    }
+    // Resolves the log entries (and read cursor) of the event action once, before it is executed
+    void setCurrentDescriptorString(QString ident);
 
     void unsetCurrentDescriptorString() {
-        m_currentDescriptorString = QString();
+        m_hasCurrent = false;
+        m_current_double = -1;
+        m_current_unsigned = -1;
     }
 
     void setMode(ReplayMode value) {
@@ -89,9 +93,13 @@ private:
 
     DLog m_in_double_log;
     ULog m_in_unsigned_log;
+    QVector<int> m_double_cursors; // next entry to read, for each descriptor in m_in_double_log
+    QVector<int> m_unsigned_cursors;
 
     ReplayMode m_mode;
-    QString m_currentDescriptorString;
+    bool m_hasCurrent;
+    int m_current_double; // index of the current descriptor in m_in_double_log, -1 if it is not in the log
+    int m_current_unsigned;
 };
 
 #endif // DATALOG_H
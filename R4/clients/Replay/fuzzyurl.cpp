@@ -26,27 +26,189 @@
 
 #include <QStringList>
 
+#include <algorithm>
+
 #include "fuzzyurl.h"
 
-FuzzyUrlMatcher::FuzzyUrlMatcher(const QUrl& url)
+static bool queryItemKeyLessThan(const CompiledUrl::QueryItem& a, const CompiledUrl::QueryItem& b)
+{
+    return a.first < b.first;
+}
+
+CompiledUrl::CompiledUrl()
+    : m_atoms(0)
+    , m_url(0)
+    , m_host(0)
+    , m_hasQuery(false)
+    , m_hasFragment(false)
+{
+}
+
+CompiledUrl::CompiledUrl(const QUrl& url, UrlAtomTable* atoms)
+    : m_atoms(atoms)
+    , m_url(atoms->intern(QString::fromAscii(url.toEncoded())))
+    , m_host(atoms->intern(url.host()))
+    , m_hasQuery(url.hasQuery())
+    , m_hasFragment(url.hasFragment())
+{
+    QStringList pathFragments = url.path().split(QString::fromAscii("/"));
+
+    m_path.reserve(pathFragments.size());
+    foreach (const QString& fragment, pathFragments) {
+        m_path.append(atoms->intern(fragment));
+    }
+
+    QPair<QString, QString> item;
+    foreach (item, url.queryItems()) {
+        m_query.append(QueryItem(atoms->intern(item.first), atoms->intern(item.second)));
+    }
+
+    std::stable_sort(m_query.begin(), m_query.end(), queryItemKeyLessThan);
+}
+
+CompiledUrl::CompiledUrl(const CompiledUrl& other)
+    : m_atoms(other.m_atoms)
+    , m_url(other.m_url)
+    , m_host(other.m_host)
+    , m_path(other.m_path)
+    , m_query(other.m_query)
+    , m_hasQuery(other.m_hasQuery)
+    , m_hasFragment(other.m_hasFragment)
+{
+    retainAtoms();
+}
+
+CompiledUrl::~CompiledUrl()
+{
+    releaseAtoms();
+}
+
+CompiledUrl& CompiledUrl::operator=(const CompiledUrl& other)
+{
+    if (this != &other) {
+        releaseAtoms();
+
+        m_atoms = other.m_atoms;
+        m_url = other.m_url;
+        m_host = other.m_host;
+        m_path = other.m_path;
+        m_query = other.m_query;
+        m_hasQuery = other.m_hasQuery;
+        m_hasFragment = other.m_hasFragment;
+
+        retainAtoms();
+    }
+
+    return *this;
+}
+
+void CompiledUrl::retainAtoms()
+{
+    if (!m_atoms) {
+        return;
+    }
+
+    m_atoms->retain(m_url);
+    m_atoms->retain(m_host);
+
+    foreach (unsigned int id, m_path) {
+        m_atoms->retain(id);
+    }
+
+    foreach (const QueryItem& item, m_query) {
+        m_atoms->retain(item.first);
+        m_atoms->retain(item.second);
+    }
+}
+
+void CompiledUrl::releaseAtoms()
+{
+    if (!m_atoms) {
+        return;
+    }
+
+    m_atoms->release(m_url);
+    m_atoms->release(m_host);
+
+    foreach (unsigned int id, m_path) {
+        m_atoms->release(id);
+    }
+
+    foreach (const QueryItem& item, m_query) {
+        m_atoms->release(item.first);
+        m_atoms->release(item.second);
+    }
+}
+
+UrlAtomTable::UrlAtomTable()
+    : m_nextId(1) // 0 is reserved for the empty CompiledUrl
+{
+}
+
+unsigned int UrlAtomTable::intern(const QString& value)
+{
+    QHash<QString, unsigned int>::const_iterator iter = m_ids.find(value);
+
+    if (iter != m_ids.end()) {
+        retain(iter.value());
+        return iter.value();
+    }
+
+    unsigned int id = m_nextId++;
+
+    Atom atom;
+    atom.value = value;
+    atom.references = 1;
+
+    m_ids.insert(value, id);
+    m_atoms.insert(id, atom);
+
+    return id;
+}
+
+void UrlAtomTable::retain(unsigned int id)
+{
+    QHash<unsigned int, Atom>::iterator iter = m_atoms.find(id);
+    Q_ASSERT(iter != m_atoms.end());
+
+    ++iter.value().references;
+}
+
+void UrlAtomTable::release(unsigned int id)
+{
+    QHash<unsigned int, Atom>::iterator iter = m_atoms.find(id);
+    Q_ASSERT(iter != m_atoms.end());
+
+    if (--iter.value().references == 0) {
+        m_ids.remove(iter.value().value);
+        m_atoms.erase(iter);
+    }
+}
+
+FuzzyUrlMatcher::FuzzyUrlMatcher(const CompiledUrl& url)
     : m_url(url)
 {
 }
 
-unsigned int FuzzyUrlMatcher::score(const QUrl& other)
+unsigned int FuzzyUrlMatcher::score(const CompiledUrl& other)
+{
+    return score(m_url, other);
+}
+
+unsigned int FuzzyUrlMatcher::score(const CompiledUrl& url, const CompiledUrl& other)
 {
     // fastpath, the urls matches 100%
-    if (m_url == other) {
+    if (url.url() == other.url()) {
         return MATCH;
     }
 
     // Reject domain mismatches
-    if (m_url.host() != other.host()) {
+    if (url.host() != other.host()) {
         return MISMATCH;
     }
 
-    QStringList pathFragments = m_url.path().split(QString::fromAscii("/"));
-    QStringList otherPathFragments = other.path().split(QString::fromAscii("/"));
+    const QVector<unsigned int>& pathFragments = url.path();
+    const QVector<unsigned int>& otherPathFragments = other.path();
 
     // Reject path mismatches
     if (pathFragments.size() != otherPathFragments.size()) {
@@ -54,17 +216,20 @@ unsigned int FuzzyUrlMatcher::score(const QUrl& other)
     }
 
     // Reject query mismatches
-    if (m_url.hasQuery() != other.hasQuery()) {
+    if (url.hasQuery() != other.hasQuery()) {
         return MISMATCH;
     }
 
-    if (m_url.queryItems().size() != other.queryItems().size()) {
+    const QVector<CompiledUrl::QueryItem>& query = url.query();
+    const QVector<CompiledUrl::QueryItem>& otherQuery = other.query();
+
+    if (query.size() != otherQuery.size()) {
         return MISMATCH;
     }
 
     // Reject fragment mismatch
 
-    if (m_url.hasFragment() != other.hasFragment()) {
+    if (url.hasFragment() != other.hasFragment()) {
         return MISMATCH;
     }
 
@@ -73,14 +238,19 @@ unsigned int FuzzyUrlMatcher::score(const QUrl& other)
     unsigned int score = 1; // give it a score of 1 because the domain, path length, fragment and query length matches
 
     // Score 1 for each matching query value
+    // Both lists are sorted by key, and a key is compared with the first value of that key in the other URL
 
-    QPair<QString, QString> item;
-    foreach (item, m_url.queryItems()) {
-        if (!other.hasQueryItem(item.first)) {
+    int j = 0;
+    for (int i = 0; i < query.size(); ++i) {
+        while (j < otherQuery.size() && otherQuery[j].first < query[i].first) {
+            ++j;
+        }
+
+        if (j == otherQuery.size() || otherQuery[j].first != query[i].first) {
             return MISMATCH; // query keys mismatch
         }
 
-        if (item.second == other.queryItemValue(item.first)) {
+        if (query[i].second == otherQuery[j].second) {
             score++;
         }
     }
@@ -88,14 +258,16 @@ unsigned int FuzzyUrlMatcher::score(const QUrl& other)
     // Score (|query keywords| + 1) for each matching path fragment
     // This way the query score only decides the winner of URLs with matching (score wise) paths
 
-    unsigned int scorePath = m_url.queryItems().size() + 1;
+    unsigned int scorePath = query.size() + 1;
+
+    const unsigned int* a = pathFragments.constData();
+    const unsigned int* b = otherPathFragments.constData();
+    unsigned int matchingFragments = 0;
 
     // WebERA: should we have some lower limit on the number of mismatches in the path we allow? E.g. for scheduling.
-    while (!pathFragments.empty()) {
-        if (pathFragments.takeFirst() == otherPathFragments.takeFirst()) {
-            score += scorePath;
-        }
+    for (int i = 0; i < pathFragments.size(); ++i) {
+        matchingFragments += (a[i] == b[i]);
     }
 
-    return score;
+    return score + matchingFragments * scorePath;
 }
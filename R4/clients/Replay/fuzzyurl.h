@@ -29,8 +29,80 @@
 
 #include <QUrl>
 #include <QString>
+#include <QHash>
+#include <QVector>
+#include <QPair>
 #include <limits>
 
+/**
+ * Reference counted intern table mapping the strings of compiled URLs to integer ids.
+ *
+ * Ids are only comparable between URLs compiled with the same table. Every CompiledUrl holds a reference to each of
+ * its atoms, so the table only contains the strings of the URLs compiled with it that are still alive. Ids are never
+ * reused, such that a released string interned again gets a new id.
+ */
+class UrlAtomTable
+{
+public:
+    UrlAtomTable();
+
+    unsigned int intern(const QString&);
+    void retain(unsigned int id);
+    void release(unsigned int id);
+
+    int size() const { return m_atoms.size(); }
+
+private:
+    struct Atom {
+        QString value;
+        unsigned int references;
+    };
+
+    QHash<QString, unsigned int> m_ids;
+    QHash<unsigned int, Atom> m_atoms;
+    unsigned int m_nextId;
+};
+
+/**
+ * A URL pre-tokenized for fuzzy matching.
+ *
+ * The host, each path fragment, and each query key and value are interned into integer ids once, such that
+ * scoring two compiled URLs only compares integers. Query items are sorted (stable) by key id.
+ *
+ * The atom table must outlive the compiled URL.
+ */
+class CompiledUrl
+{
+public:
+    CompiledUrl();
+    CompiledUrl(const QUrl&, UrlAtomTable*);
+    CompiledUrl(const CompiledUrl&);
+    ~CompiledUrl();
+
+    CompiledUrl& operator=(const CompiledUrl&);
+
+    typedef QPair<unsigned int, unsigned int> QueryItem; // key id, value id
+
+    unsigned int url() const { return m_url; }
+    unsigned int host() const { return m_host; }
+    const QVector<unsigned int>& path() const { return m_path; }
+    const QVector<QueryItem>& query() const { return m_query; }
+    bool hasQuery() const { return m_hasQuery; }
+    bool hasFragment() const { return m_hasFragment; }
+
+private:
+    void retainAtoms();
+    void releaseAtoms();
+
+    UrlAtomTable* m_atoms;
+    unsigned int m_url;
+    unsigned int m_host;
+    QVector<unsigned int> m_path;
+    QVector<QueryItem> m_query;
+    bool m_hasQuery;
+    bool m_hasFragment;
+};
+
 class FuzzyUrlMatcher
 {
 public:
@@ -39,12 +111,14 @@ public:
         MISMATCH = 0
     };
 
-    FuzzyUrlMatcher(const QUrl&);
+    FuzzyUrlMatcher(const CompiledUrl&); // the URL must outlive the matcher
+
+    unsigned int score(const CompiledUrl&);
 
-    unsigned int score(const QUrl&);
+    static unsigned int score(const CompiledUrl& url, const CompiledUrl& other);
 
 private:
-    struct QUrl m_url;
+    const CompiledUrl& m_url;
 
 };
 
@@ -32,6 +32,15 @@
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <set>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <QObject>
 #include <QHash>
@@ -39,6 +48,13 @@
 #include <QTimer>
 #include <QNetworkProxy>
 #include <QString>
+#include <QFile>
+#include <QTextStream>
+#include <QMap>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFileInfo>
 
 #include <config.h>
 
@@ -54,16 +70,33 @@
 #include "replayscheduler.h"
 #include "network.h"
 #include "datalog.h"
+#include "artifactwriter.h"
+#include "screenshotdiff.h"
+#include "replaysummary.h"
+#include "packfile.h"
 
 class ReplayClientApplication : public ClientApplication {
     Q_OBJECT
 
 public:
     ReplayClientApplication(int& argc, char** argv);
+    ~ReplayClientApplication();
 
 private:
     void handleUserOptions();
     void snapshotState(QString id);
+    uint htmlHash();
+    void writeSummary();
+    void packOutdir();
+    void cleanup();
+
+    static QString createTemporaryDirectory();
+    static QSize readRecordedViewportSize(const QString& schedulePath);
+    static void removeTemporaryDirectory(const QString& path);
+
+    // Fatal errors std::exit anywhere in the replay, the application is cleaned up from an exit handler
+    static ReplayClientApplication* s_application;
+    static void cleanupAtExit();
 
     QString m_url;
     QString m_outdir;
@@ -72,6 +105,10 @@ private:
     QString m_logNetworkPath;
     QString m_logRandomPath;
     QString m_logTimePath;
+    QString m_logLatencyPath;
+
+    // Bodies of network snapshots recorded with -body_store
+    QString m_bodyStorePath;
 
     ReplayScheduler* m_scheduler;
     TimeProviderReplay* m_timeProvider;
@@ -82,32 +119,121 @@ private:
     bool m_showWindow;
 
     int m_schedulerTimeout;
+    double m_timeoutFactor; // learned timeouts are p99 recorded latency times this factor, 0 disables them
+
+    QSet<int> m_relaxable; // event actions sliced out of the schedule
+
+    QString m_screenshotBaselinePath;
+    bool m_screenshotThumbnail;
+
+    // Structured outcome, written to out.summary.json at exit
+    ReplaySummary m_summary;
+    QElapsedTimer m_clock;
+    qint64 m_replayStart;
+
+    // Packed output, m_outdir is a private temporary directory appended to the container as <prefix>/<file> at exit
+    QString m_outPackPath;
+    QString m_outPackPrefix;
+    bool m_outPacked;
+
+    // -in_dir container extracted to a temporary directory, removed at exit by the process which extracted it
+    QString m_inPackDir;
+    pid_t m_inPackOwner;
+
+    // Artifacts written by snapshotState
+    enum ArtifactLevel {
+        ARTIFACTS_MINIMAL,  // status.data (result and HTML hash)
+        ARTIFACTS_STANDARD, // + schedule, ER_actionlog, screenshot and errors (as used by the batch report)
+        ARTIFACTS_FULL      // + network, time and random logs, arcs.log and fuzzy.network.log
+    };
+
+    ArtifactLevel m_artifactLevel;
+    ArtifactWriter m_artifactWriter;
+    uint m_htmlHash;
+
+    // Fork-server mode
+    typedef QPair<QString, QString> ForkVariant; // schedule path, out dir
+    QList<ForkVariant> m_forkVariants;
+    int m_forkAt;
+    int m_forkJobs;
+
+    // Convergence with a baseline replay
+    struct Fingerprint {
+        uint next;    // next event action in the schedule
+        uint dom;     // structural hash of all frames
+        uint pending; // event actions waiting to be scheduled
+        uint js;      // last values written to JavaScript memory locations
+    };
+
+    typedef QMap<unsigned int, Fingerprint> Fingerprints; // by schedule index
+    Fingerprints m_fingerprints;
+    Fingerprints m_baselineFingerprints;
+    QString m_fingerprintsOutPath;
+    unsigned int m_fingerprintInterval;
+    bool m_divergedFromBaseline;
 
 public slots:
     void slSchedulerDone();
     void slTimeout();
+    void slStrictTimeout();
+    void slCheckpoint(unsigned int scheduleIndex);
+    void slFingerprint(unsigned int scheduleIndex);
 };
 
 /**
- * schedule.data log.network.data log.random.data log.time.data ->
+ * schedule.data log.network.data log.random.data log.time.data [log.latency.data] ->
  *  schedule.out.data log.network.out.data log.random.out.data log.time.out.data ER_actionlog errors.log replay.png
  */
 ReplayClientApplication::ReplayClientApplication(int& argc, char** argv)
-    : ClientApplication(argc, argv)
+    : ClientApplication(argc, argv, true)
     , m_outdir("/tmp/")
     , m_isStopping(false)
     , m_showWindow(true)
     , m_schedulerTimeout(20000)
+    , m_timeoutFactor(3)
+    , m_screenshotThumbnail(false)
+    , m_replayStart(0)
+    , m_outPacked(false)
+    , m_inPackOwner(0)
+    , m_artifactLevel(ARTIFACTS_FULL)
+    , m_htmlHash(0)
+    , m_forkAt(-1)
+    , m_forkJobs(1)
+    , m_fingerprintInterval(25)
+    , m_divergedFromBaseline(false)
 {
+    m_clock.start();
+
+    s_application = this;
+    std::atexit(cleanupAtExit);
 
     handleUserOptions();
 
+    if (isHeadless()) {
+        QSize viewport = readRecordedViewportSize(m_schedulePath);
+        if (viewport.isValid()) {
+            setHeadlessViewportSize(viewport);
+        }
+    }
+
     // Network
 
     m_network = new QNetworkReplyControllableFactoryReplay(m_logNetworkPath);
 
+    if (!m_bodyStorePath.isEmpty()) {
+        // Only read, the written network log keeps its bodies (see QNetworkSnapshotBodyStore)
+        WebCore::QNetworkSnapshotBodyStore* bodyStore = new WebCore::QNetworkSnapshotBodyStore(m_bodyStorePath, WebCore::QNetworkSnapshotBodyStore::READ_ONLY);
+
+        if (!bodyStore->isValid()) {
+            std::cerr << "Error: Could not open body store " << m_bodyStorePath.toStdString() << std::endl;
+            std::exit(1);
+        }
+
+        m_network->setBodyStore(bodyStore);
+    }
+
     WebCore::QNetworkReplyControllableFactory::setFactory(m_network);
-    m_window->page()->networkAccessManager()->setCookieJar(new WebCore::QNetworkSnapshotCookieJar(this));
+    page()->networkAccessManager()->setCookieJar(new WebCore::QNetworkSnapshotCookieJar(this));
 
     // Random
 
@@ -123,21 +249,45 @@ ReplayClientApplication::ReplayClientApplication(int& argc, char** argv)
 
     m_scheduler = new ReplayScheduler(m_schedulePath.toStdString(), m_network, m_timeProvider, m_randomProvider, m_schedulerTimeout);
     QObject::connect(m_scheduler, SIGNAL(sigDone()), this, SLOT(slSchedulerDone()));
+    QObject::connect(m_scheduler, SIGNAL(sigStrictTimeout()), this, SLOT(slStrictTimeout()), Qt::DirectConnection);
+
+    if (!m_relaxable.isEmpty()) {
+        m_scheduler->setRelaxable(m_relaxable);
+    }
+
+    LatencyLog latencyLog;
+    if (m_timeoutFactor > 0 && latencyLog.readLogFile(m_logLatencyPath)) {
+        m_scheduler->setLearnedTimeouts(latencyLog, m_timeoutFactor);
+    }
+
+    if (m_forkAt != -1 && !m_forkVariants.isEmpty()) {
+        m_scheduler->setCheckpoint(m_forkAt);
+        QObject::connect(m_scheduler, SIGNAL(sigCheckpoint(unsigned int)), this, SLOT(slCheckpoint(unsigned int)), Qt::DirectConnection);
+    }
+
+    if (!m_fingerprintsOutPath.isEmpty() || !m_baselineFingerprints.isEmpty()) {
+        m_scheduler->setFingerprintInterval(m_fingerprintInterval);
+        ActionLogTrackMemoryValues(true);
+        QObject::connect(m_scheduler, SIGNAL(sigFingerprint(unsigned int)), this, SLOT(slFingerprint(unsigned int)), Qt::DirectConnection);
+    }
 
     WebCore::ThreadTimers::setScheduler(m_scheduler);
 
     // Replay-mode setup
 
-    m_window->page()->enableReplayUserEventMode();
-    m_window->page()->mainFrame()->enableReplayUserEventMode();
+    page()->enableReplayUserEventMode();
+    page()->mainFrame()->enableReplayUserEventMode();
 
     // Load website and run
 
     loadWebsite(m_url);
 
     if (m_showWindow) {
-        m_window->show();
+        showWindow();
     }
+
+    m_replayStart = m_clock.elapsed();
+    m_summary.setTiming("setup", m_replayStart);
 }
 
 void ReplayClientApplication::handleUserOptions()
@@ -147,12 +297,21 @@ void ReplayClientApplication::handleUserOptions()
     if (args.contains(QString::fromAscii("-help")) || args.size() == 1) {
         qDebug() << "Usage:" << m_programName.toLatin1().data()
                  << "[-hidewindow]"
+                 << "[-headless]"
                  << "[-timeout]"
                  << "[-out_dir]"
-                 << "[-in_dir]"
+                 << "[-in_dir <dir>|<container> [-in_pack_prefix <name>]]"
+                 << "[-out_pack <container> [-out_pack_prefix <name>]]"
                  << "[-verbose]"
                  << "[-scheduler_timeout_ms]"
+                 << "[-timeout_factor <factor>]"
+                 << "[-relaxable <file>]"
                  << "[-proxy URL:PORT]"
+                 << "[-body_store <dir>]"
+                 << "[-fork_at <schedule index> -fork_variants <file> [-fork_jobs <n>]]"
+                 << "[-artifacts minimal|standard|full]"
+                 << "[-screenshot_baseline <png> [-screenshot_thumbnail]]"
+                 << "[-fingerprints_out <file>] [-converge_with <file>] [-fingerprint_every <n>]"
                  << "<URL> [<schedule>|<schedule> <log.network.data> <log.random.data> <log.time.data>]";
         std::exit(0);
     }
@@ -175,10 +334,53 @@ void ReplayClientApplication::handleUserOptions()
          indir = takeOptionValue(&args, indirIndex);
     }
 
+    // Input packed by a previous replay (or record), extract it such that the readers see the usual files
+    if (PackFile::isContainer(indir)) {
+        QString inPackPrefix;
+
+        int inPackPrefixIndex = args.indexOf("-in_pack_prefix");
+        if (inPackPrefixIndex != -1) {
+            inPackPrefix = takeOptionValue(&args, inPackPrefixIndex);
+        }
+
+        QString container = indir;
+        m_inPackDir = createTemporaryDirectory();
+        m_inPackOwner = getpid();
+        indir = m_inPackDir + "/";
+
+        if (PackFile::extract(container, inPackPrefix, indir) == 0) {
+            std::cerr << "Error: No entries with prefix " << inPackPrefix.toStdString() << " in " << container.toStdString() << std::endl;
+            std::exit(1);
+        }
+    }
+
+    int outPackIndex = args.indexOf("-out_pack");
+    if (outPackIndex != -1) {
+        m_outPackPath = takeOptionValue(&args, outPackIndex);
+        m_outdir = createTemporaryDirectory();
+    }
+
+    int outPackPrefixIndex = args.indexOf("-out_pack_prefix");
+    if (outPackPrefixIndex != -1) {
+        m_outPackPrefix = takeOptionValue(&args, outPackPrefixIndex);
+    }
+
+    if (!m_outPackPath.isEmpty() && m_outPackPrefix.isEmpty()) {
+        // Replays sharing a container would replace each other's entries, default to the unique temporary directory name
+        m_outPackPrefix = QFileInfo(m_outdir).fileName();
+        std::cout << "Packing artifacts with prefix " << m_outPackPrefix.toStdString() << std::endl;
+    }
+
+    int bodyStoreIndex = args.indexOf("-body_store");
+    if (bodyStoreIndex != -1) {
+        m_bodyStorePath = takeOptionValue(&args, bodyStoreIndex);
+    }
+
     m_schedulePath = indir + "schedule.data";
     m_logNetworkPath = indir + "/log.network.data";
     m_logTimePath = indir + "/log.time.data";
     m_logRandomPath = indir + "/log.random.data";
+    m_logLatencyPath = indir + "/log.latency.data";
 
     WebCore::threadGlobalData().threadTimers().eventActionRegister()->setVerbose(false);
     int verboseIndex = args.indexOf("-verbose");
@@ -212,6 +414,160 @@ void ReplayClientApplication::handleUserOptions()
         m_schedulerTimeout = takeOptionValue(&args, schedulerTimeoutIndex).toInt();
     }
 
+    int timeoutFactorIndex = args.indexOf("-timeout_factor");
+    if (timeoutFactorIndex != -1) {
+        m_timeoutFactor = takeOptionValue(&args, timeoutFactorIndex).toDouble();
+    }
+
+    int forkAtIndex = args.indexOf("-fork_at");
+    if (forkAtIndex != -1) {
+        m_forkAt = takeOptionValue(&args, forkAtIndex).toInt();
+
+        // The forked children would share the display server connection of the parent
+        if (!isHeadless()) {
+            std::cerr << "-fork_at requires -headless" << std::endl;
+            std::exit(1);
+        }
+
+#ifdef Q_WS_X11
+        std::cerr << "-fork_at requires a QPA build of Qt, -headless still connects to the X server otherwise" << std::endl;
+        std::exit(1);
+#endif
+    }
+
+    int forkJobsIndex = args.indexOf("-fork_jobs");
+    if (forkJobsIndex != -1) {
+        m_forkJobs = std::max(1, takeOptionValue(&args, forkJobsIndex).toInt());
+    }
+
+    int forkVariantsIndex = args.indexOf("-fork_variants");
+    if (forkVariantsIndex != -1) {
+        // One variant per line: <schedule path> <out dir>
+        QFile variantsFile(takeOptionValue(&args, forkVariantsIndex));
+        if (!variantsFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::cerr << "Could not open fork variants file" << std::endl;
+            std::exit(1);
+        }
+
+        QTextStream in(&variantsFile);
+        for (int lineNumber = 1; !in.atEnd(); ++lineNumber) {
+            QString line = in.readLine();
+            QStringList parts = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+
+            if (parts.isEmpty()) {
+                continue;
+            }
+
+            if (parts.size() != 2) {
+                std::cerr << "Malformed fork variant at " << variantsFile.fileName().toStdString() << ":" << lineNumber
+                          << ", expected <schedule path> <out dir>: " << line.toStdString() << std::endl;
+                std::exit(1);
+            }
+
+            m_forkVariants.append(ForkVariant(parts.at(0), parts.at(1)));
+        }
+
+        variantsFile.close();
+    }
+
+    int fingerprintsOutIndex = args.indexOf("-fingerprints_out");
+    if (fingerprintsOutIndex != -1) {
+        m_fingerprintsOutPath = takeOptionValue(&args, fingerprintsOutIndex);
+    }
+
+    int fingerprintEveryIndex = args.indexOf("-fingerprint_every");
+    if (fingerprintEveryIndex != -1) {
+        m_fingerprintInterval = std::max(1, takeOptionValue(&args, fingerprintEveryIndex).toInt());
+    }
+
+    int convergeWithIndex = args.indexOf("-converge_with");
+    if (convergeWithIndex != -1) {
+        // One fingerprint per line: <schedule index> <next> <dom> <pending> <js>, as written by -fingerprints_out
+        QFile baselineFile(takeOptionValue(&args, convergeWithIndex));
+        if (!baselineFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::cerr << "Could not open baseline fingerprints file" << std::endl;
+            std::exit(1);
+        }
+
+        QTextStream in(&baselineFile);
+        for (int lineNumber = 1; !in.atEnd(); ++lineNumber) {
+            QString line = in.readLine();
+            QStringList parts = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+
+            if (parts.isEmpty()) {
+                continue;
+            }
+
+            bool valid = parts.size() == 5;
+            uint values[5];
+
+            for (int i = 0; valid && i < 5; ++i) {
+                values[i] = parts.at(i).toUInt(&valid);
+            }
+
+            if (!valid) {
+                std::cerr << "Malformed fingerprint at " << baselineFile.fileName().toStdString() << ":" << lineNumber
+                          << ", expected <schedule index> <next> <dom> <pending> <js>: " << line.toStdString() << std::endl;
+                std::exit(1);
+            }
+
+            Fingerprint fingerprint;
+            fingerprint.next = values[1];
+            fingerprint.dom = values[2];
+            fingerprint.pending = values[3];
+            fingerprint.js = values[4];
+            m_baselineFingerprints.insert(values[0], fingerprint);
+        }
+
+        baselineFile.close();
+    }
+
+    int relaxableIndex = args.indexOf("-relaxable");
+    if (relaxableIndex != -1) {
+        // One recorded event action ID per line, as written by utils/slice-schedule.py
+        QFile relaxableFile(takeOptionValue(&args, relaxableIndex));
+        if (!relaxableFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            std::cerr << "Could not open relaxable event actions file" << std::endl;
+            std::exit(1);
+        }
+
+        QTextStream in(&relaxableFile);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (!line.isEmpty()) {
+                m_relaxable.insert(line.toInt());
+            }
+        }
+
+        relaxableFile.close();
+    }
+
+    int screenshotBaselineIndex = args.indexOf("-screenshot_baseline");
+    if (screenshotBaselineIndex != -1) {
+        m_screenshotBaselinePath = takeOptionValue(&args, screenshotBaselineIndex);
+    }
+
+    int screenshotThumbnailIndex = args.indexOf("-screenshot_thumbnail");
+    if (screenshotThumbnailIndex != -1) {
+        m_screenshotThumbnail = true;
+    }
+
+    int artifactsIndex = args.indexOf("-artifacts");
+    if (artifactsIndex != -1) {
+        QString level = takeOptionValue(&args, artifactsIndex);
+
+        if (level == "minimal") {
+            m_artifactLevel = ARTIFACTS_MINIMAL;
+        } else if (level == "standard") {
+            m_artifactLevel = ARTIFACTS_STANDARD;
+        } else if (level == "full") {
+            m_artifactLevel = ARTIFACTS_FULL;
+        } else {
+            std::cerr << "Unknown artifact level " << level.toStdString() << std::endl;
+            std::exit(1);
+        }
+    }
+
     int lastArg = args.lastIndexOf(QRegExp("^-.*"));
     if (lastArg == -1)
         lastArg = 0;
@@ -236,6 +592,154 @@ void ReplayClientApplication::slTimeout() {
     m_scheduler->timeout();
 }
 
+/**
+ * The scheduler exits right after a timeout in strict mode, write the summary (and pack) while we still can.
+ */
+void ReplayClientApplication::slStrictTimeout()
+{
+    m_summary.setTiming("replay", m_clock.elapsed() - m_replayStart);
+
+    std::cout << "Schedule partially executed, timed out in strict mode." << std::endl;
+    std::cout << "Result: ERROR" << std::endl;
+    m_summary.setResult("ERROR", "strict_timeout");
+
+    m_htmlHash = htmlHash();
+    std::cout << "HTML-hash: " << m_htmlHash << std::endl;
+
+    writeSummary();
+    m_isStopping = true;
+}
+
+/**
+ * Fork-server mode
+ *
+ * All variants share the schedule prefix [0, scheduleIndex) with the schedule we are replaying. We are called in front of
+ * scheduleIndex when the event loop is quiescent, fork a child per variant, and let each child continue with the suffix of
+ * its own schedule and write its own out_dir. The parent waits for its children and then continues the original schedule.
+ *
+ * The replay is single threaded, thus the children inherit a consistent copy of the page, the network snapshots, and the
+ * time and random logs. A display server connection can not be shared, thus -fork_at requires -headless on a QPA build.
+ */
+void ReplayClientApplication::slCheckpoint(unsigned int scheduleIndex)
+{
+    std::cout << "Fork-server checkpoint reached at schedule index " << scheduleIndex << std::endl;
+
+    int running = 0;
+
+    foreach (const ForkVariant& variant, m_forkVariants) {
+
+        while (running >= m_forkJobs) {
+            if (waitpid(-1, NULL, 0) > 0) {
+                --running;
+            } else {
+                running = 0;
+            }
+        }
+
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(NULL);
+
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            // Child, continue the replay with the suffix of the variant
+
+            if (m_outPackPath.isEmpty()) {
+                m_outdir = variant.second;
+            } else {
+                // Packed output, the out dir of the variant is its prefix in the container
+                m_outdir = createTemporaryDirectory();
+                m_outPackPrefix = variant.second;
+            }
+
+            m_forkVariants.clear();
+
+            if (!QDir().mkpath(m_outdir)) {
+                std::cerr << "Error: Could not create the out dir " << m_outdir.toStdString() << " of a fork-server variant." << std::endl;
+                std::exit(1);
+            }
+
+            // stdout and stderr share one file descriptor, such that their output is interleaved in order
+            QString stdoutPath = m_outdir + "/stdout.txt";
+            if (freopen(stdoutPath.toStdString().c_str(), "w", stdout) == NULL ||
+                dup2(fileno(stdout), fileno(stderr)) == -1) {
+                std::cerr << "Error: Could not redirect the output of a fork-server variant to " << stdoutPath.toStdString() << std::endl;
+                std::exit(1);
+            }
+
+            if (!m_scheduler->replaceScheduleSuffix(variant.first.toStdString())) {
+                std::cerr << "Error: Schedule " << variant.first.toStdString() << " does not share the first "
+                          << scheduleIndex << " event actions with the checkpoint." << std::endl;
+                WTF::WarningCollectorReport("WEBERA_SCHEDULER", "Fork-server variant does not match checkpoint prefix.", variant.first.toStdString());
+                m_scheduler->stop(ERROR);
+            }
+
+            return;
+        }
+
+        if (pid < 0) {
+            perror("fork");
+            continue;
+        }
+
+        ++running;
+    }
+
+    while (running > 0 && waitpid(-1, NULL, 0) > 0) {
+        --running;
+    }
+}
+
+/**
+ * Convergence with a baseline replay
+ *
+ * At every fingerprint index (before executing it) we record the next event action, the DOM (structural hash), the set
+ * of pending event actions and the JavaScript state. Once the replay has diverged from the baseline (the next event
+ * action differed at some index), and the DOM, pending event actions and JavaScript state match the baseline at the same
+ * index again, the remaining suffix executes as in the baseline and we stop with the CONVERGED status.
+ *
+ * The JavaScript state is the last value written to each memory location in the action log. Locations and values naming
+ * objects contain pointers or cell indices, which may differ between runs. Such replays do not converge, and are compared
+ * in full.
+ */
+void ReplayClientApplication::slFingerprint(unsigned int scheduleIndex)
+{
+    Fingerprint fingerprint;
+    fingerprint.next = qHash(QString::fromStdString(m_scheduler->getNextEventActionString()));
+    fingerprint.dom = htmlHash();
+    fingerprint.pending = 0;
+    fingerprint.js = ActionLogMemoryFingerprint();
+
+    std::set<std::string> pending = WebCore::threadGlobalData().threadTimers().eventActionRegister()->getWaitingNames();
+    for (std::set<std::string>::const_iterator iter = pending.begin(); iter != pending.end(); ++iter) {
+        fingerprint.pending = fingerprint.pending * 31 + qHash(QString::fromStdString(*iter));
+    }
+
+    m_fingerprints.insert(scheduleIndex, fingerprint);
+
+    Fingerprints::const_iterator baseline = m_baselineFingerprints.find(scheduleIndex);
+    if (baseline == m_baselineFingerprints.end()) {
+        return;
+    }
+
+    if (baseline->next != fingerprint.next) {
+        m_divergedFromBaseline = true;
+        return;
+    }
+
+    if (m_divergedFromBaseline && baseline->dom == fingerprint.dom && baseline->pending == fingerprint.pending &&
+        baseline->js == fingerprint.js) {
+        std::cout << "Converged with the baseline at schedule index " << scheduleIndex << std::endl;
+
+        std::stringstream details;
+        details << "Schedule index " << scheduleIndex;
+        WTF::WarningCollectorReport("WEBERA_SCHEDULER", "Replay converged with the baseline, stopped early.", details.str());
+
+        m_scheduler->stop(CONVERGED);
+    }
+}
+
 void ReplayClientApplication::snapshotState(QString id) {
 
     // Set paths
@@ -267,111 +771,329 @@ void ReplayClientApplication::snapshotState(QString id) {
         statusfile << "Result: ERROR" << std::endl;
         break;
 
+    case CONVERGED:
+        statusfile << "Result: CONVERGED" << std::endl;
+        break;
+
     default:
         statusfile << "Result: ERROR" << std::endl;
         break;
     }
 
+    m_htmlHash = htmlHash();
+
+    statusfile << "HTML-hash: " << m_htmlHash << std::endl;
+
+    statusfile.close();
+
+    m_summary.addArtifact("status", outStatusPath);
+
+    if (m_artifactLevel == ARTIFACTS_MINIMAL) {
+        return;
+    }
+
+    // happens before (read by er-classify.sh and er-code-file.sh)
+
+    std::string erLogData;
+    if (ActionLogSerialize(&erLogData)) {
+        m_artifactWriter.writeData(outErLogPath, QByteArray(erLogData.data(), erLogData.size()));
+    } else {
+        ActionLogSave(outErLogPath.toStdString());
+    }
+
+    m_summary.addArtifact("er_actionlog", outErLogPath);
+
+    // schedule
+
+    std::stringstream schedule;
+    WebCore::threadGlobalData().threadTimers().eventActionRegister()->dispatchHistory()->serialize(schedule);
+    std::string scheduleData = schedule.str();
+    m_artifactWriter.writeData(outSchedulePath, QByteArray(scheduleData.data(), scheduleData.size()));
+    m_summary.addArtifact("schedule", outSchedulePath);
+
+    if (m_artifactLevel == ARTIFACTS_FULL) {
+
+        // network
+
+        m_network->writeNetworkFile(outLogNetworkPath);
+
+        // log
+
+        m_timeProvider->writeLogFile(outLogTimePath);
+        m_randomProvider->writeLogFile(outLogRandomPath);
+
+        m_summary.addArtifact("network", outLogNetworkPath);
+        m_summary.addArtifact("time", outLogTimePath);
+        m_summary.addArtifact("random", outLogRandomPath);
+    }
+
+    // Screenshot (rendered now, encoded by the artifact writer)
+
+    QImage screenshot = renderScreenshot();
+    QImage baseline = m_screenshotBaselinePath.isEmpty() ? QImage() : QImage(m_screenshotBaselinePath);
+
+    if (baseline.isNull()) {
+        m_artifactWriter.writeImage(screenshotPath, screenshot);
+        m_summary.addArtifact("screenshot", screenshotPath);
+    } else {
+        // Compared in-process, the full page PNG is not needed by the batch report
+        ScreenshotDiff diff = ScreenshotDiff::compare(baseline, screenshot);
+
+        m_artifactWriter.writeData(m_outdir + "/comparison.txt", diff.comparisonMeta());
+        m_artifactWriter.writeData(m_outdir + "/" + id + "screenshot.diff", diff.summary());
+
+        m_summary.addArtifact("comparison", m_outdir + "/comparison.txt");
+        m_summary.addArtifact("screenshot_diff", m_outdir + "/" + id + "screenshot.diff");
+
+        if (m_screenshotThumbnail) {
+            m_artifactWriter.writeImage(m_outdir + "/comparison.png", diff.thumbnail(screenshot));
+            m_summary.addArtifact("comparison_thumbnail", m_outdir + "/comparison.png");
+        }
+    }
+
+    // Errors
+    WTF::WarningCollecterWriteToLogFile(logErrorsPath.toStdString());
+    m_summary.addArtifact("errors", logErrorsPath);
+}
+
+uint ReplayClientApplication::htmlHash()
+{
     uint htmlHash = 0; // this will overflow as we are using it, but that is as exptected
 
     QList<QWebFrame*> queue;
-    queue.append(m_window->page()->mainFrame());
+    queue.append(page()->mainFrame());
 
     while (!queue.empty()) {
         QWebFrame* current = queue.takeFirst();
-        htmlHash += qHash(current->toHtml());
+        htmlHash += current->structuralHash();
         queue.append(current->childFrames());
     }
 
-    statusfile << "HTML-hash: " << htmlHash << std::endl;
+    return htmlHash;
+}
 
-    statusfile.close();
+/**
+ * Write out.summary.json, after all other artifacts are on disk.
+ */
+void ReplayClientApplication::writeSummary()
+{
+    m_summary.setHtmlHash(m_htmlHash);
+    m_summary.setSchedule(m_scheduler->getScheduleSize(), m_scheduler->getScheduleIndex());
 
-    // happens before
+    const ReplaySchedulerStatistics& statistics = m_scheduler->getStatistics();
 
-    ActionLogSave(outErLogPath.toStdString());
+    foreach (const ReplaySchedulerStatistics::ModeTransition& transition, statistics.modeTransitions) {
+        m_summary.addModeTransition(replayModeName(transition.mode), transition.scheduleIndex);
+    }
 
-    // schedule
+    unsigned int networkFuzzyMatched;
+    unsigned int networkMissed;
+    m_network->countFuzzyMatches(&networkFuzzyMatched, &networkMissed);
+
+    m_summary.setCounter("event_actions_fuzzy_matched", statistics.fuzzyMatched);
+    m_summary.setCounter("event_actions_skipped", statistics.skipped);
+    m_summary.setCounter("event_actions_executed_from_pending", statistics.pendingExecuted);
+    m_summary.setCounter("event_actions_relaxed_executed", statistics.relaxedExecuted);
+    m_summary.setCounter("ghost_event_actions", m_scheduler->getGhostEventActionCount());
+    m_summary.setCounter("network_fuzzy_matched", networkFuzzyMatched);
+    m_summary.setCounter("network_missed", networkMissed);
+
+    qint64 writeStart = m_clock.elapsed();
+    m_artifactWriter.finish();
+    m_summary.setTiming("artifacts", m_clock.elapsed() - writeStart);
+    m_summary.setTiming("total", m_clock.elapsed());
+
+    if (!m_outPackPath.isEmpty()) {
+        m_summary.relocateArtifacts(m_outdir, m_outPackPrefix);
+    }
+
+    m_summary.write(m_outdir + "/out.summary.json");
+
+    packOutdir();
+}
 
-    std::ofstream schedulefile;
-    schedulefile.open(outSchedulePath.toStdString().c_str());
-    WebCore::threadGlobalData().threadTimers().eventActionRegister()->dispatchHistory()->serialize(schedulefile);
-    schedulefile.close();
+/**
+ * Append all artifacts of this replay to the -out_pack container and remove the temporary out dir.
+ *
+ * WebERA: Artifacts are written to a private directory and packed once at exit, instead of threading the container
+ * through every writer (logs, ER_actionlog, screenshots). Replays sharing a container append under a lock.
+ */
+void ReplayClientApplication::packOutdir()
+{
+    if (m_outPackPath.isEmpty() || m_outPacked) {
+        return;
+    }
 
-    // network
+    m_outPacked = true;
 
-    m_network->writeNetworkFile(outLogNetworkPath);
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(NULL);
 
-    // log
+    if (!PackFile::appendDirectory(m_outPackPath, m_outPackPrefix, m_outdir)) {
+        std::cerr << "Warning: Artifacts kept in " << m_outdir.toStdString() << std::endl;
+        return;
+    }
 
-    m_timeProvider->writeLogFile(outLogTimePath);
-    m_randomProvider->writeLogFile(outLogRandomPath);
+    removeTemporaryDirectory(m_outdir);
+}
 
-    // Screenshot
+/**
+ * Pack whatever was written so far and remove the temporary directories, on every exit path.
+ */
+void ReplayClientApplication::cleanup()
+{
+    packOutdir();
 
-    m_window->takeScreenshot(screenshotPath);
+    if (!m_inPackDir.isEmpty() && m_inPackOwner == getpid()) {
+        removeTemporaryDirectory(m_inPackDir);
+        m_inPackDir.clear();
+    }
+}
 
-    // Errors
-    WTF::WarningCollecterWriteToLogFile(logErrorsPath.toStdString());
+ReplayClientApplication* ReplayClientApplication::s_application = 0;
 
+void ReplayClientApplication::cleanupAtExit()
+{
+    if (s_application) {
+        s_application->cleanup();
+    }
+}
+
+ReplayClientApplication::~ReplayClientApplication()
+{
+    cleanup();
+    s_application = 0;
+}
+
+QString ReplayClientApplication::createTemporaryDirectory()
+{
+    char path[] = "/tmp/r4-replay-XXXXXX";
+
+    if (mkdtemp(path) == NULL) {
+        perror("mkdtemp");
+        std::exit(1);
+    }
+
+    return QString::fromAscii(path);
+}
+
+/**
+ * The viewport of the recording, written to the status.data next to the recorded schedule (invalid if unknown)
+ */
+QSize ReplayClientApplication::readRecordedViewportSize(const QString& schedulePath)
+{
+    QFile statusFile(QFileInfo(schedulePath).absolutePath() + "/status.data");
+
+    if (!statusFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QSize();
+    }
+
+    QRegExp viewportLine("^Viewport-size: (\\d+)x(\\d+)$");
+    QTextStream in(&statusFile);
+
+    while (!in.atEnd()) {
+        if (viewportLine.exactMatch(in.readLine().trimmed())) {
+            return QSize(viewportLine.cap(1).toInt(), viewportLine.cap(2).toInt());
+        }
+    }
+
+    return QSize();
+}
+
+// Temporary directories are flat (see packOutdir and PackFile::extract)
+void ReplayClientApplication::removeTemporaryDirectory(const QString& path)
+{
+    QDir directory(path);
+    foreach (const QString& file, directory.entryList(QDir::Files | QDir::Hidden)) {
+        directory.remove(file);
+    }
+
+    directory.rmdir(path);
 }
 
 void ReplayClientApplication::slSchedulerDone()
 {
     if (m_isStopping == false) {
 
+        qint64 snapshotStart = m_clock.elapsed();
+        m_summary.setTiming("replay", snapshotStart - m_replayStart);
+
         snapshotState(QString::fromStdString("out."));
 
         ActionLogStrictMode(false);
 
-        // Write human readable HB relation dump (DEBUG)
-        std::string arcsLogPath = m_outdir.toStdString() + "/arcs.log";
-        std::vector<ActionLog::Arc> arcs = ActionLogReportArcs();
-        std::ofstream arcslog;
-        arcslog.open(arcsLogPath.c_str());
+        if (!m_fingerprintsOutPath.isEmpty()) {
+            QFile fingerprintsFile(m_fingerprintsOutPath);
+            fingerprintsFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+
+            QTextStream out(&fingerprintsFile);
+            for (Fingerprints::const_iterator iter = m_fingerprints.begin(); iter != m_fingerprints.end(); ++iter) {
+                out << iter.key() << " " << iter->next << " " << iter->dom << " " << iter->pending << " " << iter->js << "\n";
+            }
+
+            fingerprintsFile.close();
+        }
+
+        if (m_artifactLevel == ARTIFACTS_FULL) {
+
+            // Write human readable HB relation dump (DEBUG)
+            std::stringstream arcslog;
+            std::vector<ActionLog::Arc> arcs = ActionLogReportArcs();
+
+            for (std::vector<ActionLog::Arc>::iterator it = arcs.begin(); it != arcs.end(); ++it) {
+                arcslog << (*it).m_tail << " -> " << (*it).m_head << std::endl;
+            }
 
-        for (std::vector<ActionLog::Arc>::iterator it = arcs.begin(); it != arcs.end(); ++it) {
-            arcslog << (*it).m_tail << " -> " << (*it).m_head << std::endl;
+            std::string arcsData = arcslog.str();
+            m_artifactWriter.writeData(m_outdir + "/arcs.log", QByteArray(arcsData.data(), arcsData.size()));
+
+            // Fuzzy matched network requests and their scores
+            m_network->writeFuzzyMatchReport(m_outdir + "/fuzzy.network.log");
+
+            m_summary.addArtifact("arcs", m_outdir + "/arcs.log");
+            m_summary.addArtifact("fuzzy_network", m_outdir + "/fuzzy.network.log");
         }
 
-        arcslog.close();
+        m_summary.setTiming("snapshot", m_clock.elapsed() - snapshotStart);
 
         switch (m_scheduler->getState()) {
         case FINISHED:
             std::cout << "Schedule executed successfully" << std::endl;
             std::cout << "Result: FINISHED" << std::endl;
+            m_summary.setResult("FINISHED", "Schedule executed successfully");
             break;
 
         case TIMEOUT:
             std::cout << "Schedule partially executed, timed out before finishing." << std::endl;
             std::cout << "Result: TIMEOUT" << std::endl;
+            m_summary.setResult("TIMEOUT", "Schedule partially executed, timed out before finishing");
             break;
 
         case ERROR:
             std::cout << "Schedule partially executed, could not finish schedule!" << std::endl;
             std::cout << "Result: ERROR" << std::endl;
+            m_summary.setResult("ERROR", "Schedule partially executed, could not finish schedule");
+            break;
+
+        case CONVERGED:
+            std::cout << "Schedule partially executed, converged with the baseline." << std::endl;
+            std::cout << "Result: CONVERGED" << std::endl;
+            m_summary.setResult("CONVERGED", "Schedule partially executed, converged with the baseline");
             break;
 
         default:
             std::cout << "Scheduler stopped for an unknown reason." << std::endl;
             std::cout << "Result: ERROR" << std::endl;
+            m_summary.setResult("ERROR", "Scheduler stopped for an unknown reason");
             break;
         }
 
-        uint htmlHash = 0; // this will overflow as we are using it, but that is as exptected
-
-        QList<QWebFrame*> queue;
-        queue.append(m_window->page()->mainFrame());
-
-        while (!queue.empty()) {
-            QWebFrame* current = queue.takeFirst();
-            htmlHash += qHash(current->toHtml());
-            queue.append(current->childFrames());
-        }
+        std::cout << "HTML-hash: " << m_htmlHash << std::endl;
 
-        std::cout << "HTML-hash: " << htmlHash << std::endl;
+        writeSummary();
 
-        m_window->close();
+        closeWindow();
         m_isStopping = true;
     }
 }
@@ -379,6 +1101,7 @@ void ReplayClientApplication::slSchedulerDone()
 
 int main(int argc, char **argv)
 {
+    ClientApplication::prepareHeadless(argc, argv);
     ReplayClientApplication app(argc, argv);
 
 #ifndef NDEBUG
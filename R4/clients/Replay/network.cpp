@@ -27,13 +27,14 @@
 #include <iostream>
 #include <sstream>
 
+#include <QBuffer>
 #include <QDataStream>
 #include <QFile>
+#include <QSet>
+#include <QTextStream>
 
 #include <wtf/warningcollectorreport.h>
 
-#include "fuzzyurl.h"
-
 #include "network.h"
 
 QNetworkReplyControllableReplay::QNetworkReplyControllableReplay(WebCore::QNetworkReplyControllableFactory* factory, QNetworkReply* reply, WebCore::QNetworkReplyInitialSnapshot* snapshot, QObject* parent)
@@ -56,23 +57,298 @@ QNetworkReplyControllableFactoryReplay::QNetworkReplyControllableFactoryReplay(Q
     : QNetworkReplyControllableFactory()
     , m_mode(STRICT)
 {
-    QFile fp(logNetworkPath);
-    fp.open(QIODevice::ReadOnly);
+    m_networkFile.setFileName(logNetworkPath);
+    m_networkFile.open(QIODevice::ReadOnly);
+
+    if (m_networkFile.size() > 0) {
+        uchar* data = m_networkFile.map(0, m_networkFile.size());
+
+        if (data != NULL) {
+            m_networkData = QByteArray::fromRawData((const char*)data, m_networkFile.size());
+        } else {
+            m_networkData = m_networkFile.readAll();
+        }
+    }
+
+    // Locate snapshots using the index written with the network log, or scan the log if it is missing (old recordings,
+    // or recordings which did not shut down cleanly)
+
+    if (!readNetworkIndex(WebCore::QNetworkReplyControllableFactory::networkIndexPath(logNetworkPath))) {
+        scanNetworkFile();
+    }
+
+    // Build the fuzzy matching index
+
+    SnapshotMap::const_iterator iter = m_snapshots.begin();
+    for (; iter != m_snapshots.end(); ++iter) {
+
+        QString key = fuzzyBucketKey((*iter)->compiledUrl);
+
+        FuzzyBucketMap::iterator bucket = m_fuzzyBuckets.find(key);
+        if (bucket == m_fuzzyBuckets.end()) {
+            bucket = m_fuzzyBuckets.insert(key, new FuzzyBucket());
+        }
+
+        int index = (*bucket)->lists.size();
+        (*bucket)->lists.append(*iter);
+
+        foreach (quint64 token, fuzzyTokens((*iter)->compiledUrl)) {
+            (*bucket)->postings[token].append(index);
+        }
+    }
+
+    // Tokens shared by all candidates in a bucket add the same score to all of them, drop them
+    FuzzyBucketMap::iterator bucket = m_fuzzyBuckets.begin();
+    for (; bucket != m_fuzzyBuckets.end(); ++bucket) {
+
+        QHash<quint64, Postings>::iterator postings = (*bucket)->postings.begin();
+        while (postings != (*bucket)->postings.end()) {
+            if (postings->size() == (*bucket)->lists.size()) {
+                postings = (*bucket)->postings.erase(postings);
+            } else {
+                ++postings;
+            }
+        }
+    }
+}
+
+QNetworkReplyControllableFactoryReplay::~QNetworkReplyControllableFactoryReplay()
+{
+    qDeleteAll(m_fuzzyBuckets);
+    qDeleteAll(m_snapshots);
+}
+
+void QNetworkReplyControllableFactoryReplay::addSnapshotLocation(const QUrl& url, quint32 sameUrlSequenceNumber, qint64 offset, qint64 length)
+{
+    SnapshotLocation location;
+    location.sameUrlSequenceNumber = sameUrlSequenceNumber;
+    location.offset = offset;
+    location.length = length;
+
+    QString key = url.toString();
+
+    SnapshotMap::iterator iter = m_snapshots.find(key);
+    if (iter == m_snapshots.end()) {
+        iter = m_snapshots.insert(key, new SnapshotList(url, &m_urlAtoms));
+    }
+
+    // Snapshots are stored in the order requests finished, replay them in the order requests were made
+    int position = (*iter)->size();
+    while (position > 0 && (*iter)->at(position - 1).sameUrlSequenceNumber > sameUrlSequenceNumber) {
+        --position;
+    }
+
+    (*iter)->insert(position, location);
+}
+
+bool QNetworkReplyControllableFactoryReplay::readNetworkIndex(QString logNetworkIndexPath)
+{
+    QFile fp(logNetworkIndexPath);
+
+    if (!fp.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&fp);
+
+    quint32 magic;
+    quint32 version;
+    in >> magic >> version;
+
+    if (magic != WebCore::QNetworkReplyControllableFactory::NETWORK_INDEX_MAGIC ||
+        version != WebCore::QNetworkReplyControllableFactory::NETWORK_INDEX_VERSION) {
+        std::cout << "Warning: Ignoring network index (" << logNetworkIndexPath.toStdString() << ") of unknown version" << std::endl;
+        return false;
+    }
 
     while (!fp.atEnd()) {
-        WebCore::QNetworkReplyInitialSnapshot* snapshot = WebCore::QNetworkReplyInitialSnapshot::deserialize(&fp);
+        QUrl url;
+        quint32 sameUrlSequenceNumber;
+        qint64 offset;
+        qint64 length;
+
+        in >> url >> sameUrlSequenceNumber >> offset >> length;
+
+        if (in.status() != QDataStream::Ok || offset < 0 || length <= 0 || offset + length > m_networkData.size()) {
+            std::cout << "Warning: Network index (" << logNetworkIndexPath.toStdString() << ") does not match the network log, ignoring it" << std::endl;
+
+            qDeleteAll(m_snapshots);
+            m_snapshots.clear();
+            return false;
+        }
+
+        addSnapshotLocation(url, sameUrlSequenceNumber, offset, length);
+    }
+
+    return true;
+}
+
+void QNetworkReplyControllableFactoryReplay::scanNetworkFile()
+{
+    QBuffer buffer(&m_networkData);
+    buffer.open(QIODevice::ReadOnly);
+
+    while (!buffer.atEnd()) {
+        qint64 offset = buffer.pos();
+
+        WebCore::QNetworkReplyInitialSnapshot* snapshot = WebCore::QNetworkReplyInitialSnapshot::deserialize(&buffer);
+
+        if (snapshot == 0) {
+            // The recorder did not shut down cleanly, everything before the partially written snapshot is usable
+            std::cout << "Warning: Ignoring truncated network log after " << offset << " of " << m_networkData.size() << " bytes" << std::endl;
+            break;
+        }
+
+        addSnapshotLocation(snapshot->getUrl(), snapshot->getSameUrlSequenceNumber(), offset, buffer.pos() - offset);
+        delete snapshot;
+    }
+}
+
+WebCore::QNetworkReplyInitialSnapshot* QNetworkReplyControllableFactoryReplay::materialize(const SnapshotLocation& location)
+{
+    QByteArray data = QByteArray::fromRawData(m_networkData.constData() + location.offset, location.length);
+
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    WebCore::QNetworkReplyInitialSnapshot* snapshot = WebCore::QNetworkReplyInitialSnapshot::deserialize(&buffer, bodyStore());
+
+    if (!snapshot->missingBodyHash().isEmpty()) {
+        // Replaying without the body would silently diverge from the recording
+        std::cerr << "Error: Network body " << snapshot->missingBodyHash().constData() << " of " << snapshot->getUrl().toString().toStdString();
 
-        QString url = snapshot->getUrl().toString();
+        if (bodyStore() == 0) {
+            std::cerr << " is in a body store, pass -body_store <dir>" << std::endl;
+        } else {
+            std::cerr << " not found in body store " << bodyStore()->path().toStdString() << std::endl;
+        }
+
+        std::exit(1);
+    }
+
+    return snapshot;
+}
+
+/**
+ * Everything which must be identical for FuzzyUrlMatcher to give a non-zero score.
+ */
+QString QNetworkReplyControllableFactoryReplay::fuzzyBucketKey(const CompiledUrl& url)
+{
+    QString key = QString::number(url.host()) + "|" + QString::number(url.path().size()) + "|" + QString::number(url.hasQuery()) + "|" + QString::number(url.hasFragment());
+
+    foreach (const CompiledUrl::QueryItem& item, url.query()) {
+        key += "|" + QString::number(item.first);
+    }
+
+    return key;
+}
+
+/**
+ * The parts of an URL contributing to its fuzzy match score, path fragments (per position) and query values (per key).
+ *
+ * Only the first value of a query key is used, as FuzzyUrlMatcher only compares against the first value.
+ */
+QList<quint64> QNetworkReplyControllableFactoryReplay::fuzzyTokens(const CompiledUrl& url)
+{
+    QList<quint64> tokens;
+
+    for (int i = 0; i < url.path().size(); ++i) {
+        tokens.append((((quint64)i | 0x80000000) << 32) | url.path().at(i));
+    }
+
+    const QVector<CompiledUrl::QueryItem>& query = url.query();
+    for (int i = 0; i < query.size(); ++i) {
+        if (i == 0 || query.at(i - 1).first != query.at(i).first) {
+            tokens.append(((quint64)query.at(i).first << 32) | query.at(i).second);
+        }
+    }
+
+    return tokens;
+}
+
+QNetworkReplyControllableFactoryReplay::SnapshotList* QNetworkReplyControllableFactoryReplay::fuzzyMatch(const CompiledUrl& url, unsigned int* score)
+{
+    *score = 0;
+
+    FuzzyBucketMap::const_iterator bucket = m_fuzzyBuckets.find(fuzzyBucketKey(url));
+    if (bucket == m_fuzzyBuckets.end()) {
+        return NULL;
+    }
+
+    const QList<SnapshotList*>& lists = (*bucket)->lists;
+
+    // Score candidates sharing at least one token with the request
+
+    QSet<int> candidates;
+    foreach (quint64 token, fuzzyTokens(url)) {
+        QHash<quint64, Postings>::const_iterator postings = (*bucket)->postings.find(token);
+        if (postings != (*bucket)->postings.end()) {
+            foreach (int index, *postings) {
+                candidates.insert(index);
+            }
+        }
+    }
+
+    FuzzyUrlMatcher matcher(url);
+
+    int bestIndex = -1;
+    foreach (int index, candidates) {
+
+        if (lists.at(index)->isEmpty()) {
+            continue; // skip emtpy lists
+        }
+
+        unsigned int candidateScore = matcher.score(lists.at(index)->compiledUrl);
+
+        if (candidateScore > *score || (candidateScore == *score && index < bestIndex)) {
+            *score = candidateScore;
+            bestIndex = index;
+        }
+    }
 
-        SnapshotMap::iterator iter = m_snapshots.find(url);
-        if (iter == m_snapshots.end()) {
-            SnapshotList* list = new SnapshotList();
-            list->append(snapshot);
-            m_snapshots.insert(url, list);
+    // All other candidates in the bucket score equally, use the first one in the bucket
+
+    if (bestIndex == -1) {
+        for (int index = 0; index < lists.size(); ++index) {
+            if (!lists.at(index)->isEmpty()) {
+                *score = matcher.score(lists.at(index)->compiledUrl);
+                bestIndex = index;
+                break;
+            }
+        }
+    }
+
+    if (bestIndex == -1 || *score == 0) {
+        *score = 0;
+        return NULL;
+    }
+
+    return lists.at(bestIndex);
+}
+
+void QNetworkReplyControllableFactoryReplay::countFuzzyMatches(unsigned int* matched, unsigned int* missed) const
+{
+    *matched = 0;
+    *missed = 0;
+
+    foreach (const FuzzyMatch& match, m_fuzzyMatches) {
+        if (match.match.isEmpty()) {
+            (*missed)++;
         } else {
-            (*iter)->append(snapshot);
+            (*matched)++;
         }
+    }
+}
+
+void QNetworkReplyControllableFactoryReplay::writeFuzzyMatchReport(QString path)
+{
+    QFile fp(path);
+    fp.open(QIODevice::WriteOnly | QIODevice::Truncate);
+
+    QTextStream out(&fp);
 
+    foreach (const FuzzyMatch& match, m_fuzzyMatches) {
+        out << match.score << " " << match.request << " " << (match.match.isEmpty() ? QString::fromAscii("-") : match.match) << "\n";
     }
 
     fp.close();
@@ -92,7 +368,7 @@ WebCore::QNetworkReplyControllable* QNetworkReplyControllableFactoryReplay::cons
         // It could be that we have replayed all known instances of this URL
         // If that is the case let it flow through the relaxedReplayMode logic or error out
         if (!(*iter)->isEmpty()) {
-            return new QNetworkReplyControllableReplay(this, reply, (*iter)->takeFirst(), parent);
+            return new QNetworkReplyControllableReplay(this, reply, materialize((*iter)->takeFirst()), parent);
         }
     }
 
@@ -102,42 +378,26 @@ WebCore::QNetworkReplyControllable* QNetworkReplyControllableFactoryReplay::cons
 
         std::cout << "Warning: No exact match for URL (" << reply->url().toString().toStdString() << ") found, fuzzy matching" << std::endl;
 
-        FuzzyUrlMatcher matcher(reply->url());
-
         unsigned int bestScore = 0;
-        WebCore::QNetworkReplyInitialSnapshot* bestSnapshot = NULL;
-        SnapshotMap::const_iterator bestList;
-
-        iter = m_snapshots.begin();
-        for (; iter != m_snapshots.end(); iter++) {
-
-            if ((*iter)->isEmpty()) {
-                continue; // skip emtpy lists
-            }
+        SnapshotList* bestList = fuzzyMatch(CompiledUrl(reply->url(), &m_urlAtoms), &bestScore);
 
-            WebCore::QNetworkReplyInitialSnapshot* snapshot = (*iter)->first();
-
-            unsigned int score = matcher.score(snapshot->getUrl());
-
-            if (score > bestScore) {
-                bestScore = score;
-                bestSnapshot = snapshot;
-                bestList = iter;
-            }
-        }
+        FuzzyMatch match;
+        match.request = reply->url().toString();
+        match.match = bestList != NULL ? bestList->url.toString() : QString();
+        match.score = bestScore;
+        m_fuzzyMatches.append(match);
 
-        if (bestSnapshot != NULL) {
+        if (bestList != NULL) {
             // We found a fuzzy match
 
             std::stringstream details;
-            details << "Network request " << reply->url().toString().toStdString() << " fuzzy matched with " << bestSnapshot->getUrl().toString().toStdString() << ".";
+            details << "Network request " << reply->url().toString().toStdString() << " fuzzy matched with " << bestList->url.toString().toStdString() << ".";
 
             WTF::WarningCollectorReport("WEBERA_NETWORK_DATA", "Network message fuzzy matched in best effort mode.", details.str());
 
-            std::cout << "Fuzzy match found (" << bestSnapshot->getUrl().toString().toStdString() << ")" << std::endl;
+            std::cout << "Fuzzy match found (" << bestList->url.toString().toStdString() << ")" << std::endl;
 
-            (*bestList)->pop_front();
-            return new QNetworkReplyControllableReplay(this, reply, bestSnapshot, parent);
+            return new QNetworkReplyControllableReplay(this, reply, materialize(bestList->takeFirst()), parent);
         }
 
         std::stringstream details;
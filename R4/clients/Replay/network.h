@@ -28,11 +28,14 @@
 #define NETWORK_H
 
 #include <QMultiHash>
+#include <QFile>
+#include <QByteArray>
 
 #include <JavaScriptCore/runtime/JSExportMacros.h>
 #include <WebCore/platform/network/qt/QNetworkReplyHandler.h>
 
 #include "replaymode.h"
+#include "fuzzyurl.h"
 
 class QNetworkReplyControllableFactoryReplay;
 
@@ -50,6 +53,7 @@ class QNetworkReplyControllableFactoryReplay : public WebCore::QNetworkReplyCont
 
 public:
     QNetworkReplyControllableFactoryReplay(QString logNetworkPath);
+    ~QNetworkReplyControllableFactoryReplay();
 
     WebCore::QNetworkReplyControllable* construct(QNetworkReply* reply, QObject* parent=0);
 
@@ -57,11 +61,76 @@ public:
         m_mode = value;
     }
 
+    void writeFuzzyMatchReport(QString path);
+
+    // Requests without an exact match, which were fuzzy matched or missed (served by a live connection)
+    void countFuzzyMatches(unsigned int* matched, unsigned int* missed) const;
+
 private:
-    typedef QList<WebCore::QNetworkReplyInitialSnapshot*> SnapshotList;
+    /**
+     * Snapshots are located in the (mapped) network log, and only deserialized when a request actually uses them.
+     */
+    struct SnapshotLocation {
+        quint32 sameUrlSequenceNumber;
+        qint64 offset;
+        qint64 length;
+    };
+
+    class SnapshotList : public QList<SnapshotLocation> {
+    public:
+        SnapshotList(const QUrl& url, UrlAtomTable* atoms)
+            : url(url)
+            , compiledUrl(url, atoms)
+        {
+        }
+
+        QUrl url;
+        CompiledUrl compiledUrl; // compiled once, used for fuzzy matching
+    };
+
     typedef QHash<QString, SnapshotList*> SnapshotMap;
     SnapshotMap m_snapshots;
+    UrlAtomTable m_urlAtoms; // atoms of the live compiled URLs: m_snapshots, and the request being fuzzy matched
     ReplayMode m_mode;
+
+    void addSnapshotLocation(const QUrl& url, quint32 sameUrlSequenceNumber, qint64 offset, qint64 length);
+    bool readNetworkIndex(QString logNetworkIndexPath);
+    void scanNetworkFile();
+
+    WebCore::QNetworkReplyInitialSnapshot* materialize(const SnapshotLocation& location);
+
+    QFile m_networkFile;
+    QByteArray m_networkData; // mapped network log (or a copy if it could not be mapped)
+
+    /**
+     * Secondary index used for fuzzy matching.
+     *
+     * Snapshot lists are bucketed by everything FuzzyUrlMatcher requires to be identical (host, number of path
+     * fragments and the query keys), such that a miss only has to look at a single bucket. Inside a bucket, each
+     * path fragment (by position) and each query value (by key) is indexed, such that only candidates sharing at
+     * least one of these with the request have to be scored.
+     */
+    typedef QList<int> Postings; // indices into FuzzyBucket::lists
+    struct FuzzyBucket {
+        QList<SnapshotList*> lists;
+        QHash<quint64, Postings> postings;
+    };
+
+    typedef QHash<QString, FuzzyBucket*> FuzzyBucketMap;
+    FuzzyBucketMap m_fuzzyBuckets;
+
+    static QString fuzzyBucketKey(const CompiledUrl& url);
+    static QList<quint64> fuzzyTokens(const CompiledUrl& url);
+
+    SnapshotList* fuzzyMatch(const CompiledUrl& url, unsigned int* score);
+
+    struct FuzzyMatch {
+        QString request;
+        QString match; // empty if no match was found
+        unsigned int score;
+    };
+
+    QList<FuzzyMatch> m_fuzzyMatches;
 };
 
 #endif // NETWORK_H
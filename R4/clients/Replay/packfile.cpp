@@ -0,0 +1,217 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <iostream>
+
+#include <sys/file.h>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+
+#include "packfile.h"
+
+namespace {
+
+QString entryName(const QString& prefix, const QString& file)
+{
+    return prefix.isEmpty() ? file : prefix + "/" + file;
+}
+
+}
+
+bool PackFile::append(const QString& containerPath, const QString& name, const QByteArray& data)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+
+    QByteArray encodedName = name.toUtf8();
+
+    out << (quint32)MAGIC << (quint32)VERSION << (quint32)encodedName.size();
+    out.writeRawData(encodedName.constData(), encodedName.size());
+    out << (quint64)data.size();
+
+    QFile fp(containerPath);
+    if (!fp.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        std::cerr << "Warning: Could not open container " << containerPath.toStdString() << std::endl;
+        return false;
+    }
+
+    // Other replays may append to the same container, keep each entry contiguous
+    flock(fp.handle(), LOCK_EX);
+
+    bool written = fp.write(header) == header.size() && fp.write(data) == data.size() && fp.flush();
+
+    flock(fp.handle(), LOCK_UN);
+    fp.close();
+
+    if (!written) {
+        std::cerr << "Warning: Could not append " << name.toStdString() << " to " << containerPath.toStdString() << std::endl;
+    }
+
+    return written;
+}
+
+bool PackFile::appendDirectory(const QString& containerPath, const QString& prefix, const QString& directory)
+{
+    bool success = true;
+
+    QFileInfoList files = QDir(directory).entryInfoList(QDir::Files, QDir::Name);
+
+    foreach (const QFileInfo& file, files) {
+        QFile fp(file.filePath());
+
+        if (!fp.open(QIODevice::ReadOnly)) {
+            std::cerr << "Warning: Could not read " << file.filePath().toStdString() << std::endl;
+            success = false;
+            continue;
+        }
+
+        success = append(containerPath, entryName(prefix, file.fileName()), fp.readAll()) && success;
+        fp.close();
+    }
+
+    return success;
+}
+
+QList<PackFile::Entry> PackFile::tableOfContents(const QString& containerPath)
+{
+    QList<Entry> entries;
+
+    QFile fp(containerPath);
+    if (!fp.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+
+    QDataStream in(&fp);
+
+    while (!in.atEnd()) {
+        quint32 magic;
+        quint32 version;
+        quint32 nameSize;
+        in >> magic >> version >> nameSize;
+
+        if (in.status() != QDataStream::Ok || magic != MAGIC || version != VERSION) {
+            break;
+        }
+
+        QByteArray name(nameSize, '\0');
+        if (in.readRawData(name.data(), nameSize) != (int)nameSize) {
+            break;
+        }
+
+        quint64 size;
+        in >> size;
+
+        if (in.status() != QDataStream::Ok || fp.pos() + (qint64)size > fp.size()) {
+            break; // truncated entry
+        }
+
+        Entry entry;
+        entry.name = QString::fromUtf8(name.constData(), name.size());
+        entry.offset = fp.pos();
+        entry.size = size;
+        entries.append(entry);
+
+        fp.seek(entry.offset + entry.size);
+    }
+
+    return entries;
+}
+
+int PackFile::extract(const QString& containerPath, const QString& prefix, const QString& directory)
+{
+    // Latest entry per file
+    QHash<QString, Entry> latest;
+    QList<QString> order;
+
+    QString entryPrefix = prefix.isEmpty() ? QString() : prefix + "/";
+
+    foreach (const Entry& entry, tableOfContents(containerPath)) {
+        if (!entry.name.startsWith(entryPrefix)) {
+            continue;
+        }
+
+        QString file = entry.name.mid(entryPrefix.size());
+        if (file.isEmpty() || file.contains("/")) {
+            continue;
+        }
+
+        if (!latest.contains(file)) {
+            order.append(file);
+        }
+
+        latest.insert(file, entry);
+    }
+
+    QFile fp(containerPath);
+    if (!fp.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    int extracted = 0;
+
+    foreach (const QString& file, order) {
+        const Entry& entry = latest[file];
+
+        fp.seek(entry.offset);
+        QByteArray data = fp.read(entry.size);
+
+        QFile out(QDir(directory).filePath(file));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(data) != data.size()) {
+            std::cerr << "Warning: Could not extract " << entry.name.toStdString() << std::endl;
+            continue;
+        }
+
+        out.close();
+        ++extracted;
+    }
+
+    return extracted;
+}
+
+bool PackFile::isContainer(const QString& path)
+{
+    QFileInfo info(path);
+
+    if (!info.isFile()) {
+        return false;
+    }
+
+    QFile fp(path);
+    if (!fp.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&fp);
+
+    quint32 magic;
+    in >> magic;
+
+    return in.status() == QDataStream::Ok && magic == MAGIC;
+}
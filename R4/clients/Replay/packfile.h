@@ -0,0 +1,75 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PACKFILE_H
+#define PACKFILE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+/**
+ * Append-only container of named entries, used instead of an output directory per replay.
+ *
+ * A container is a sequence of self-describing entries (big endian):
+ *
+ *   quint32 MAGIC, quint32 VERSION, quint32 name size, name (UTF-8), quint64 data size, data
+ *
+ * Entries are appended under an exclusive lock on the container, thus many replays (e.g. all replays of a site) can
+ * share one container. Entry names are <prefix>/<file>, and a later entry replaces an earlier entry with the same name.
+ * The table of contents is recovered by skipping from header to header, a truncated last entry is ignored.
+ *
+ * See utils/r4pack.py for listing and extracting containers.
+ */
+class PackFile {
+
+public:
+    enum {
+        MAGIC = 0x52345045, // "R4PE"
+        VERSION = 1
+    };
+
+    struct Entry {
+        QString name;
+        qint64 offset; // of the data
+        qint64 size;
+    };
+
+    static bool append(const QString& containerPath, const QString& name, const QByteArray& data);
+
+    // Append all files in directory as <prefix>/<file name>
+    static bool appendDirectory(const QString& containerPath, const QString& prefix, const QString& directory);
+
+    // Entries in container order, including replaced entries
+    static QList<Entry> tableOfContents(const QString& containerPath);
+
+    // Write the (latest) entries named <prefix>/<file> to directory/<file>, returns the number of extracted entries
+    static int extract(const QString& containerPath, const QString& prefix, const QString& directory);
+
+    static bool isContainer(const QString& path);
+};
+
+#endif // PACKFILE_H
@@ -11,12 +11,20 @@ SOURCES += \
     replayscheduler.cpp \
     network.cpp \
     fuzzyurl.cpp \
-    datalog.cpp
+    datalog.cpp \
+    artifactwriter.cpp \
+    screenshotdiff.cpp \
+    replaysummary.cpp \
+    packfile.cpp
 
 HEADERS += \
     replayscheduler.h \
     network.h \
     fuzzyurl.h \
     datalog.h \
-    replaymode.h
+    replaymode.h \
+    artifactwriter.h \
+    screenshotdiff.h \
+    replaysummary.h \
+    packfile.h
 
@@ -31,4 +31,19 @@ enum ReplayMode {
     STRICT, BEST_EFFORT, BEST_EFFORT_NOND, STOP
 };
 
+inline const char* replayModeName(ReplayMode mode) {
+    switch (mode) {
+    case STRICT:
+        return "STRICT";
+    case BEST_EFFORT:
+        return "BEST_EFFORT";
+    case BEST_EFFORT_NOND:
+        return "BEST_EFFORT_NOND";
+    case STOP:
+        return "STOP";
+    }
+
+    return "UNKNOWN";
+}
+
 #endif // REPLAYMODE_H
@@ -23,6 +23,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -38,9 +39,41 @@
 
 #include "replayscheduler.h"
 
+static bool isFuzzyMatchable(const std::string& eventActionType)
+{
+    return eventActionType == "Network" || eventActionType == "HTMLDocumentParser" || eventActionType == "DOMTimer" ||
+            eventActionType == "BrowserLoadUrl" || eventActionType == "ScriptRunner";
+}
+
+// Sequence parameters (1-5) compared when fuzzy matching, 0 if the parameter is not used for the given type
+static unsigned long fuzzySequenceNumber(const WTF::EventActionDescriptor& descriptor, const std::string& eventActionType, unsigned int number)
+{
+    bool used = false;
+
+    switch (number) {
+    case 1:
+        used = eventActionType == "Network" || eventActionType == "DOMTimer" || eventActionType == "HTMLDocumentParser" || eventActionType == "ScriptRunner";
+        break;
+    case 2:
+        used = eventActionType == "Network" || eventActionType == "DOMTimer" || eventActionType == "ScriptRunner";
+        break;
+    case 3:
+    case 4:
+    case 5:
+        used = eventActionType == "DOMTimer";
+        break;
+    }
+
+    return used ? QString::fromStdString(descriptor.getParameter(number)).toULong() : 0;
+}
+
 ReplayScheduler::ReplayScheduler(const std::string& schedulePath, QNetworkReplyControllableFactoryReplay* networkProvider, TimeProviderReplay* timeProvider, RandomProviderReplay* randomProvider, int schedulerTimeout)
     : QObject(NULL)
     , Scheduler()
+    , m_scheduleIndex(0)
+    , m_checkpointIndex(-1)
+    , m_fingerprintInterval(0)
+    , m_lastFingerprintIndex(-1)
     , m_networkProvider(networkProvider)
     , m_timeProvider(timeProvider)
     , m_randomProvider(randomProvider)
@@ -56,17 +89,133 @@ ReplayScheduler::ReplayScheduler(const std::string& schedulePath, QNetworkReplyC
     std::ifstream fp;
     fp.open(schedulePath.c_str());
     m_schedule = WebCore::EventActionSchedule::deserialize(fp);
+    m_originalSchedule = new WebCore::EventActionSchedule(*m_schedule);
     m_schedule->reverse();
     fp.close();
 
     m_eventActionTimeoutTimer.setInterval(m_timeout_miliseconds); // an event action must be executed within x miliseconds
     m_eventActionTimeoutTimer.setSingleShot(true);
     connect(&m_eventActionTimeoutTimer, SIGNAL(timeout()), this, SLOT(slEventActionTimeout()));
+
+    WebCore::threadGlobalData().threadTimers().eventActionRegister()->setWaitingIndexKeyFunction(&ReplayScheduler::fuzzyIndexKey, &ReplayScheduler::fuzzyIndexData, this);
 }
 
 ReplayScheduler::~ReplayScheduler()
 {
+    // The compiled URLs stored in the waiting index reference m_urlAtoms
+    WebCore::threadGlobalData().threadTimers().eventActionRegister()->setWaitingIndexKeyFunction(0);
+
     delete m_schedule;
+    delete m_originalSchedule;
+}
+
+/**
+ * Fork-server support. Replace the remaining (non-executed) part of the schedule with the suffix of another schedule.
+ *
+ * The other schedule must share the prefix executed so far with the schedule we were constructed with, otherwise
+ * the state we have reached is not a valid starting point for it and we refuse to switch.
+ */
+bool ReplayScheduler::replaceScheduleSuffix(const std::string& schedulePath)
+{
+    std::ifstream fp;
+    fp.open(schedulePath.c_str());
+
+    if (!fp.is_open()) {
+        return false;
+    }
+
+    WebCore::EventActionSchedule* variant = WebCore::EventActionSchedule::deserialize(fp);
+    fp.close();
+
+    if (!m_schedule_backlog.isEmpty() || variant->size() < m_scheduleIndex) {
+        delete variant;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < m_scheduleIndex; ++i) {
+        const WebCore::EventActionScheduleItem& expected = m_originalSchedule->at(i);
+        const WebCore::EventActionScheduleItem& actual = variant->at(i);
+
+        if (expected.second.isNull() != actual.second.isNull() ||
+                (!expected.second.isNull() && expected.second.toUnpatchedString() != actual.second.toUnpatchedString())) {
+            delete variant;
+            return false;
+        }
+    }
+
+    delete m_schedule;
+    m_schedule = new WebCore::EventActionSchedule();
+
+    for (size_t i = variant->size(); i > m_scheduleIndex; --i) {
+        m_schedule->append(variant->at(i - 1));
+    }
+
+    delete m_originalSchedule;
+    m_originalSchedule = variant;
+
+    m_eventActionTimeoutTimer.stop();
+    m_skipAfterNextTry = false;
+
+    return true;
+}
+
+namespace {
+
+class FuzzyIndexData : public WebCore::EventActionIndexData {
+public:
+    FuzzyIndexData(const std::string& url, UrlAtomTable* atoms)
+        : compiledUrl(QUrl(QString::fromStdString(url)), atoms)
+    {
+    }
+
+    CompiledUrl compiledUrl;
+};
+
+}
+
+/**
+ * The URL parameter of a waiting (fuzzy matchable) event action, compiled once when its handler is registered and
+ * released by the EventActionRegister when it is descheduled.
+ */
+WebCore::EventActionIndexData* ReplayScheduler::fuzzyIndexData(void* object, const WTF::EventActionDescriptor& descriptor)
+{
+    ReplayScheduler* scheduler = static_cast<ReplayScheduler*>(object);
+    return new FuzzyIndexData(descriptor.getParameter(0), &scheduler->m_urlAtoms);
+}
+
+/**
+ * Index key used to bucket waiting event actions for fuzzy matching.
+ *
+ * The key contains the sequence parameters which must match exactly (for DOMTimers this includes the interval), and
+ * everything which must be identical for FuzzyUrlMatcher to give a non-zero score (host, number of path fragments,
+ * query and fragment shape). Thus, a fuzzy match only has to score the candidates in a single bucket.
+ */
+std::string ReplayScheduler::fuzzyIndexKey(const WTF::EventActionDescriptor& descriptor)
+{
+    std::string eventActionType = descriptor.getType();
+
+    if (!isFuzzyMatchable(eventActionType)) {
+        return std::string();
+    }
+
+    std::stringstream key;
+    key << eventActionType
+        << "|" << fuzzySequenceNumber(descriptor, eventActionType, 1)
+        << "|" << fuzzySequenceNumber(descriptor, eventActionType, 2)
+        << "|" << fuzzySequenceNumber(descriptor, eventActionType, 3)
+        << "|" << fuzzySequenceNumber(descriptor, eventActionType, 5);
+
+    // DOMTimers can be matched on their parent ID alone, thus the URL is not part of their key
+    if (eventActionType != "DOMTimer") {
+        QUrl url(QString::fromStdString(descriptor.getParameter(0)));
+
+        key << "|" << url.host().toStdString()
+            << "|" << url.path().split(QString::fromAscii("/")).size()
+            << "|" << url.hasQuery() << "|" << url.queryItems().size()
+            << "|" << url.hasFragment();
+    }
+
+    return key.str();
 }
 
 void ReplayScheduler::eventActionScheduled(const WTF::EventActionDescriptor&,
@@ -77,6 +226,15 @@ void ReplayScheduler::eventActionScheduled(const WTF::EventActionDescriptor&,
     }
 }
 
+std::string ReplayScheduler::getNextEventActionString() const
+{
+    if (m_schedule->isEmpty() || m_schedule->last().second.isNull()) {
+        return std::string();
+    }
+
+    return m_schedule->last().second.toUnpatchedString();
+}
+
 void ReplayScheduler::executeDelayedEventActions(WebCore::EventActionRegister* eventActionRegister)
 {
     while (executeDelayedEventAction(eventActionRegister)) {
@@ -84,34 +242,101 @@ void ReplayScheduler::executeDelayedEventActions(WebCore::EventActionRegister* e
     }
 }
 
+/**
+ * Execute the first enabled relaxable event action skipped earlier. Only called when the next scheduled event action
+ * is not enabled (or the schedule is done), such that relaxed event actions never run in front of the kept schedule.
+ */
+bool ReplayScheduler::executeRelaxedEventAction(WebCore::EventActionRegister* eventActionRegister)
+{
+    for (size_t i = 0; i < m_relaxed_backlog.size(); ++i) {
+        ActionLogStrictMode(false);
+        bool success = tryExecuteEventActionDescriptor(eventActionRegister, m_relaxed_backlog[i]);
+        ActionLogStrictMode(true);
+        if (success) {
+            m_relaxed_backlog.remove(i);
+            m_statistics.relaxedExecuted++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool ReplayScheduler::executeDelayedEventAction(WebCore::EventActionRegister* eventActionRegister)
 {
+    if (m_schedule->isEmpty() && m_mode != STOP && executeRelaxedEventAction(eventActionRegister)) {
+        return true;
+    }
+
     if (m_schedule->isEmpty() || m_mode == STOP) {
         stop(FINISHED, eventActionRegister);
         return false;
     }
 
+    if (m_checkpointIndex != -1 && (unsigned int)m_checkpointIndex == m_scheduleIndex && m_schedule_backlog.isEmpty()) {
+        // Quiescent point in front of the requested schedule index, nothing is dispatching and
+        // nothing is pending. Handlers of this signal may fork() and replace the schedule suffix.
+        m_checkpointIndex = -1;
+        emit sigCheckpoint(m_scheduleIndex);
+
+        if (m_schedule->isEmpty() || m_mode == STOP) {
+            stop(FINISHED, eventActionRegister);
+            return false;
+        }
+    }
+
+    if (m_fingerprintInterval != 0 && m_scheduleIndex % m_fingerprintInterval == 0 &&
+        (int)m_scheduleIndex != m_lastFingerprintIndex && m_schedule_backlog.isEmpty()) {
+        // First attempt at this schedule index, handlers may stop the replay if its state converged
+        m_lastFingerprintIndex = m_scheduleIndex;
+        emit sigFingerprint(m_scheduleIndex);
+
+        if (m_mode == STOP) {
+            return false;
+        }
+    }
+
     for (size_t i = 0; i < m_schedule_backlog.size(); ++i) {
         ActionLogStrictMode(false);
         bool success = tryExecuteEventActionDescriptor(eventActionRegister, m_schedule_backlog[i]);
         ActionLogStrictMode(true);
         if (success) {
             m_schedule_backlog.remove(i);
+            m_statistics.pendingExecuted++;
             WTF::WarningCollectorReport("WEBERA_SCHEDULER", "Event action executed from pending schedule.", "");
             return true;
         }
     }
 
-    bool success = tryExecuteEventActionDescriptor(eventActionRegister, m_schedule->last());
+    const WebCore::EventActionScheduleItem& next = m_schedule->last();
+    bool success = tryExecuteEventActionDescriptor(eventActionRegister, next);
 
     if (success) {
         m_schedule->removeLast();
+        ++m_scheduleIndex;
 
         m_skipAfterNextTry = false;
         m_eventActionTimeoutTimer.stop();
 
         return true;
 
+    } else if (!next.second.isNull() && m_relaxable.contains(next.first)) {
+
+        // Sliced out of the schedule, thus nothing we need depends on it. Continue without waiting, and execute it
+        // if it is enabled later on.
+
+        m_relaxed_backlog.append(next);
+        m_schedule->removeLast();
+        ++m_scheduleIndex;
+
+        return true;
+
+    } else if (executeRelaxedEventAction(eventActionRegister)) {
+
+        // The next event action is not enabled yet, run a relaxed event action while we wait for it
+
+        return true;
+
     } else if (m_skipAfterNextTry) {
 
         /**
@@ -134,38 +359,94 @@ bool ReplayScheduler::executeDelayedEventAction(WebCore::EventActionRegister* ev
 
         // Notice that we will continue skipping event actions until we get a hit.
 
+        // A stuck replay skips on every timeout, only dump the queue for a few exemplars
+
+        static const WTF::WarningKind skippedWarning =
+            WTF::WarningCollectorRegisterKind("WEBERA_SCHEDULER", "Event action skipped after timeout.", 20);
+
         std::stringstream detail;
-        detail << "This is the current queue of events" << std::endl;
-        debugPrintTimers(detail, WebCore::threadGlobalData().threadTimers().eventActionRegister());
 
-        WTF::WarningCollectorReport("WEBERA_SCHEDULER", "Event action skipped after timeout.", detail.str());
+        if (WTF::WarningCollectorWantsDetails(skippedWarning)) {
+            detail << "This is the current queue of events" << std::endl;
+            debugPrintTimers(detail, WebCore::threadGlobalData().threadTimers().eventActionRegister());
+        }
+
+        WTF::WarningCollectorReport(skippedWarning, detail.str());
 
         m_schedule_backlog.append(m_schedule->last());
         m_schedule->removeLast();
+        ++m_scheduleIndex;
+        m_statistics.skipped++;
 
         return true; // Go to the next event action now
 
     }
 
     if (!m_eventActionTimeoutTimer.isActive()) {
+        m_eventActionTimeoutTimer.setInterval(eventActionTimeout(m_schedule->last().second));
+        m_eventActionTimeoutTimer.start(); // start timeout for this event action
+    }
 
-        const WebCore::EventActionScheduleItem& item = m_schedule->last();
-        const WTF::EventActionDescriptor& nextToSchedule = item.second;
-        const std::string& eventActionType = nextToSchedule.getType();
+    return false;
 
-        if (eventActionType == "DOMTimer") {
-            // set timeout to match expected time to trigger the next DOMTimer
-            m_eventActionTimeoutTimer.setInterval(QString::fromStdString(nextToSchedule.getParameter(2)).toULong() + m_timeout_aggressive_miliseconds);
-        } else {
-            m_eventActionTimeoutTimer.setInterval(m_mode == BEST_EFFORT ? m_timeout_aggressive_miliseconds : m_timeout_miliseconds);
+}
+
+/**
+ * Derive a timeout per event action type from the latencies observed while recording.
+ *
+ * Types with too few samples keep the fixed timeouts. Learned timeouts are never shorter than the aggressive timeout
+ * and never longer than the scheduler timeout, thus a diverged schedule gives up early while slow types keep their budget.
+ * They only shorten the timeout of the current mode, and are not used in strict mode.
+ */
+void ReplayScheduler::setLearnedTimeouts(const LatencyLog& latencyLog, double factor)
+{
+    static const int minSamples = 10;
+
+    m_learnedTimeouts.clear();
+
+    if (factor <= 0) {
+        return;
+    }
+
+    QHash<QString, LatencyLog::Samples>::const_iterator iter = latencyLog.samples().begin();
+    for (; iter != latencyLog.samples().end(); ++iter) {
+        quint32 p99;
+
+        if (!latencyLog.percentile(iter.key(), 0.99, minSamples, &p99)) {
+            continue;
         }
 
-        m_eventActionTimeoutTimer.start(); // start timeout for this event action
+        unsigned int timeout = (unsigned int)std::min<double>(p99 * factor, m_timeout_miliseconds);
+        m_learnedTimeouts.insert(iter.key(), std::max(timeout, m_timeout_aggressive_miliseconds));
+    }
+}
 
+unsigned int ReplayScheduler::eventActionTimeout(const WTF::EventActionDescriptor& descriptor) const
+{
+    if (descriptor.isNull()) {
+        return m_mode == BEST_EFFORT ? m_timeout_aggressive_miliseconds : m_timeout_miliseconds;
     }
 
-    return false;
+    const std::string& eventActionType = descriptor.getType();
 
+    if (eventActionType == "DOMTimer") {
+        // set timeout to match expected time to trigger the next DOMTimer
+        return QString::fromStdString(descriptor.getParameter(2)).toULong() + m_timeout_aggressive_miliseconds;
+    }
+
+    unsigned int modeTimeout = m_mode == BEST_EFFORT ? m_timeout_aggressive_miliseconds : m_timeout_miliseconds;
+
+    // A strict replay fails on its first timeout, thus it keeps the full budget regardless of what was learned
+    if (m_mode == STRICT) {
+        return modeTimeout;
+    }
+
+    LearnedTimeouts::const_iterator iter = m_learnedTimeouts.find(QString::fromStdString(eventActionType));
+    if (iter != m_learnedTimeouts.end()) {
+        return std::min(iter.value(), modeTimeout);
+    }
+
+    return modeTimeout;
 }
 
 bool ReplayScheduler::tryExecuteEventActionDescriptor(
@@ -181,6 +462,11 @@ bool ReplayScheduler::tryExecuteEventActionDescriptor(
 
     if (nextToSchedule.isNull()) {
 
+        ReplaySchedulerStatistics::ModeTransition transition;
+        transition.mode = m_mode == STRICT ? BEST_EFFORT_NOND : BEST_EFFORT;
+        transition.scheduleIndex = m_scheduleIndex;
+        m_statistics.modeTransitions.append(transition);
+
         if (m_mode == STRICT) {
             std::cout << "Entered relaxed non-deterministic replay mode" << std::endl;
             m_timeProvider->setMode(BEST_EFFORT_NOND);
@@ -265,50 +551,30 @@ bool ReplayScheduler::tryExecuteEventActionDescriptor(
           *
           */
 
-        if (eventActionType == "Network" || eventActionType == "HTMLDocumentParser" || eventActionType == "DOMTimer" ||
-                eventActionType == "BrowserLoadUrl" || eventActionType == "ScriptRunner") {
-
-            QString url = QString::fromStdString(nextToSchedule.getParameter(0));
+        if (isFuzzyMatchable(eventActionType)) {
 
-            unsigned long sequenceNumber1 = (eventActionType == "Network" || eventActionType == "DOMTimer" || eventActionType == "HTMLDocumentParser" || eventActionType == "ScriptRunner") ? QString::fromStdString(nextToSchedule.getParameter(1)).toULong() : 0;
-            unsigned long sequenceNumber2 = (eventActionType == "Network" || eventActionType == "DOMTimer" || eventActionType == "ScriptRunner") ? QString::fromStdString(nextToSchedule.getParameter(2)).toULong() : 0;
-            unsigned long sequenceNumber3 = (eventActionType == "DOMTimer") ? QString::fromStdString(nextToSchedule.getParameter(3)).toULong() : 0;
-            unsigned long sequenceNumber4 = (eventActionType == "DOMTimer") ? QString::fromStdString(nextToSchedule.getParameter(4)).toULong() : 0; // DOMTimer's parent ID, fuzzy match this one
-            unsigned long sequenceNumber5 = (eventActionType == "DOMTimer") ? QString::fromStdString(nextToSchedule.getParameter(5)).toULong() : 0;
+            unsigned long parentId = fuzzySequenceNumber(nextToSchedule, eventActionType, 4); // DOMTimer's parent ID, fuzzy match this one
 
-            FuzzyUrlMatcher* matcher = new FuzzyUrlMatcher(QUrl(url));
+            CompiledUrl expectedUrl(QUrl(QString::fromStdString(nextToSchedule.getParameter(0))), &m_urlAtoms);
+            FuzzyUrlMatcher matcher(expectedUrl);
 
-            std::set<std::string> names = eventActionRegister->getWaitingNames();
-            std::set<std::string>::const_iterator iter;
+            // Only candidates sharing the stable parts of the descriptor can get a non-zero score, see fuzzyIndexKey
+            std::vector<WebCore::WaitingEventAction> candidates = eventActionRegister->getWaitingByIndexKey(fuzzyIndexKey(nextToSchedule));
+            std::vector<WebCore::WaitingEventAction>::const_iterator iter;
 
             unsigned int bestScore = 0;
             WTF::EventActionDescriptor bestDescriptor;
 
-            for (iter = names.begin(); iter != names.end(); iter++) {
+            for (iter = candidates.begin(); iter != candidates.end(); iter++) {
 
-                WTF::EventActionDescriptor candidate = WTF::EventActionDescriptor::deserialize((*iter));
+                const WTF::EventActionDescriptor& candidate = iter->descriptor;
 
-                if (candidate.getType() != eventActionType) {
-                    continue;
-                }
-
-                unsigned long candidateSequenceNumber1 = (eventActionType == "Network" || eventActionType == "DOMTimer" || eventActionType == "HTMLDocumentParser" || eventActionType == "ScriptRunner") ? QString::fromStdString(candidate.getParameter(1)).toULong() : 0;
-                unsigned long candidateSequenceNumber2 = (eventActionType == "Network" || eventActionType == "DOMTimer" || eventActionType == "ScriptRunner") ? QString::fromStdString(candidate.getParameter(2)).toULong() : 0;
-                unsigned long candidateSequenceNumber3 = (eventActionType == "DOMTimer") ? QString::fromStdString(candidate.getParameter(3)).toULong() : 0;
-                unsigned long candidateSequenceNumber4 = (eventActionType == "DOMTimer") ? QString::fromStdString(candidate.getParameter(4)).toULong() : 0;
-                unsigned long candidateSequenceNumber5 = (eventActionType == "DOMTimer") ? QString::fromStdString(candidate.getParameter(5)).toULong() : 0;
-
-                if (candidateSequenceNumber1 != sequenceNumber1 || candidateSequenceNumber2 != sequenceNumber2 || candidateSequenceNumber3 != sequenceNumber3 ||
-                        candidateSequenceNumber5 != sequenceNumber5) {
-                    continue;
-                }
+                unsigned int score = matcher.score(static_cast<const FuzzyIndexData*>(iter->data)->compiledUrl);
 
-                unsigned int score = matcher->score(QUrl(QString::fromStdString(candidate.getParameter(0))));
-
-                if (sequenceNumber4 != 0) {
+                if (parentId != 0) {
                     score = score / 2;
 
-                    if (sequenceNumber4 == candidateSequenceNumber4) {
+                    if (parentId == fuzzySequenceNumber(candidate, eventActionType, 4)) {
                         score += UINT_MAX / 2;
                     }
                 }
@@ -336,6 +602,10 @@ bool ReplayScheduler::tryExecuteEventActionDescriptor(
 
                 m_timeProvider->unsetCurrentDescriptorString();
                 m_randomProvider->unsetCurrentDescriptorString();
+
+                if (found) {
+                    m_statistics.fuzzyMatched++;
+                }
             }
         }
 
@@ -359,10 +629,12 @@ void ReplayScheduler::slEventActionTimeout()
 
     case STRICT: {
 
-        std::cerr << std::endl << "Error: Failed execution schedule after waiting for " << m_timeout_miliseconds << " miliseconds." << std::endl;
+        std::cerr << std::endl << "Error: Failed execution schedule after waiting for " << m_eventActionTimeoutTimer.interval() << " miliseconds." << std::endl;
         std::cerr << "This is the current queue of events" << std::endl;
         debugPrintTimers(std::cerr, WebCore::threadGlobalData().threadTimers().eventActionRegister());
 
+        emit sigStrictTimeout(); // last chance to write the summary
+
         std::exit(1);
 
         break;
@@ -372,7 +644,7 @@ void ReplayScheduler::slEventActionTimeout()
         // This should not happen
 
         std::stringstream detail;
-        detail << "Error: Failed execution schedule after waiting for " << m_timeout_miliseconds << " miliseconds..." << std::endl;
+        detail << "Error: Failed execution schedule after waiting for " << m_eventActionTimeoutTimer.interval() << " miliseconds..." << std::endl;
         detail << "This is the current queue of events" << std::endl;
         debugPrintTimers(detail, WebCore::threadGlobalData().threadTimers().eventActionRegister());
 
@@ -29,7 +29,9 @@
 #include <string>
 #include <ostream>
 
+#include <QList>
 #include <QObject>
+#include <QSet>
 #include <QTimer>
 
 #include <wtf/ExportMacros.h>
@@ -47,9 +49,32 @@
 #include "replaymode.h"
 #include "datalog.h"
 #include "network.h"
+#include "fuzzyurl.h"
 
 enum ReplaySchedulerState {
-    RUNNING, TIMEOUT, FINISHED, ERROR
+    RUNNING, TIMEOUT, FINISHED, ERROR, CONVERGED
+};
+
+struct ReplaySchedulerStatistics {
+    struct ModeTransition {
+        ReplayMode mode;
+        unsigned int scheduleIndex;
+    };
+
+    QList<ModeTransition> modeTransitions;
+
+    unsigned int fuzzyMatched;     // event actions executed using a fuzzy match
+    unsigned int skipped;          // event actions skipped after a timeout
+    unsigned int pendingExecuted;  // skipped event actions executed later
+    unsigned int relaxedExecuted;  // relaxable event actions executed out of order
+
+    ReplaySchedulerStatistics()
+        : fuzzyMatched(0)
+        , skipped(0)
+        , pendingExecuted(0)
+        , relaxedExecuted(0)
+    {
+    }
 };
 
 class ReplayScheduler : public QObject, public WebCore::Scheduler
@@ -125,14 +150,73 @@ public:
 
     void timeout();
 
+    // Fork-server support: emit sigCheckpoint once the schedule reaches index, before executing it
+    void setCheckpoint(int index) {
+        m_checkpointIndex = index;
+    }
+
+    unsigned int getScheduleIndex() const {
+        return m_scheduleIndex;
+    }
+
+    unsigned int getScheduleSize() const {
+        return m_originalSchedule->size();
+    }
+
+    const ReplaySchedulerStatistics& getStatistics() const {
+        return m_statistics;
+    }
+
+    // Skipped event actions which never appeared later on
+    unsigned int getGhostEventActionCount() const {
+        return m_schedule_backlog.size();
+    }
+
+    bool replaceScheduleSuffix(const std::string& schedulePath);
+
+    // Convergence support: emit sigFingerprint every interval schedule indices, before executing it
+    void setFingerprintInterval(unsigned int interval) {
+        m_fingerprintInterval = interval;
+    }
+
+    // The next event action in the schedule (unpatched), or an empty string
+    std::string getNextEventActionString() const;
+
+    // Wait for each event action type at most factor times the p99 of the latency recorded for that type
+    void setLearnedTimeouts(const LatencyLog& latencyLog, double factor);
+
+    // Event actions (by recorded ID) which are not needed to reproduce the race of interest. The scheduler executes
+    // them in schedule order when they are enabled, but never waits for them.
+    void setRelaxable(const QSet<int>& eventActionIds) {
+        m_relaxable = eventActionIds;
+    }
+
 private:
 
     bool executeDelayedEventAction(WebCore::EventActionRegister* eventActionRegister);
+    bool executeRelaxedEventAction(WebCore::EventActionRegister* eventActionRegister);
+
+    static std::string fuzzyIndexKey(const WTF::EventActionDescriptor& descriptor);
+    static WebCore::EventActionIndexData* fuzzyIndexData(void* object, const WTF::EventActionDescriptor& descriptor);
 
     void debugPrintTimers(std::ostream& out, WebCore::EventActionRegister* eventActionRegister);
 
+    unsigned int eventActionTimeout(const WTF::EventActionDescriptor& descriptor) const;
+
     WebCore::EventActionSchedule* m_schedule;
+    WebCore::EventActionSchedule* m_originalSchedule;
     WTF::Vector<WebCore::EventActionScheduleItem> m_schedule_backlog;
+    WTF::Vector<WebCore::EventActionScheduleItem> m_relaxed_backlog; // relaxable event actions skipped before they were enabled
+
+    QSet<int> m_relaxable;
+
+    unsigned int m_scheduleIndex; // number of items consumed from m_originalSchedule
+    int m_checkpointIndex;
+
+    unsigned int m_fingerprintInterval; // 0 disables fingerprints
+    int m_lastFingerprintIndex;
+
+    UrlAtomTable m_urlAtoms; // atoms of the URLs of waiting fuzzy matchable event actions, see fuzzyIndexData
 
     QNetworkReplyControllableFactoryReplay* m_networkProvider;
     TimeProviderReplay* m_timeProvider;
@@ -149,13 +233,21 @@ private:
     unsigned int m_timeout_miliseconds;
     unsigned int m_timeout_aggressive_miliseconds;
 
+    typedef QHash<QString, unsigned int> LearnedTimeouts;
+    LearnedTimeouts m_learnedTimeouts; // by descriptor type
+
     WTF::EventActionId m_nextEventActionId;
 
+    ReplaySchedulerStatistics m_statistics;
+
 private slots:
     void slEventActionTimeout();
 
 signals:
     void sigDone();
+    void sigCheckpoint(unsigned int scheduleIndex);
+    void sigFingerprint(unsigned int scheduleIndex);
+    void sigStrictTimeout();
 };
 
 #endif // REPLAYSCHEDULER_H
@@ -0,0 +1,217 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <QDir>
+#include <QFile>
+
+#include "replaysummary.h"
+
+namespace {
+
+QByteArray quote(const QString& value)
+{
+    QByteArray result("\"");
+    QByteArray utf8 = value.toUtf8();
+
+    for (int i = 0; i < utf8.size(); ++i) {
+        char c = utf8.at(i);
+
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+                result += escaped;
+            } else {
+                result += c;
+            }
+        }
+    }
+
+    return result + "\"";
+}
+
+template <typename T>
+void replaceOrAppend(QList<QPair<QString, T> >* list, const QString& name, const T& value)
+{
+    for (int i = 0; i < list->size(); ++i) {
+        if ((*list)[i].first == name) {
+            (*list)[i].second = value;
+            return;
+        }
+    }
+
+    list->append(qMakePair(name, value));
+}
+
+}
+
+ReplaySummary::ReplaySummary()
+    : m_result("ERROR")
+    , m_htmlHash(0)
+    , m_scheduleSize(0)
+    , m_scheduleExecuted(0)
+{
+}
+
+void ReplaySummary::setResult(const QString& result, const QString& exitReason)
+{
+    m_result = result;
+    m_exitReason = exitReason;
+}
+
+void ReplaySummary::setHtmlHash(uint htmlHash)
+{
+    m_htmlHash = htmlHash;
+}
+
+void ReplaySummary::setSchedule(unsigned int size, unsigned int executed)
+{
+    m_scheduleSize = size;
+    m_scheduleExecuted = executed;
+}
+
+void ReplaySummary::addModeTransition(const QString& mode, unsigned int scheduleIndex)
+{
+    m_modeTransitions.append(qMakePair(mode, scheduleIndex));
+}
+
+void ReplaySummary::setCounter(const QString& name, unsigned int value)
+{
+    replaceOrAppend(&m_counters, name, value);
+}
+
+void ReplaySummary::setTiming(const QString& phase, qint64 miliseconds)
+{
+    replaceOrAppend(&m_timings, phase, miliseconds);
+}
+
+void ReplaySummary::addArtifact(const QString& name, const QString& path)
+{
+    replaceOrAppend(&m_artifacts, name, path);
+}
+
+void ReplaySummary::relocateArtifacts(const QString& directory, const QString& prefix)
+{
+    QString root = QDir::cleanPath(directory) + "/";
+
+    for (int i = 0; i < m_artifacts.size(); ++i) {
+        QString path = QDir::cleanPath(m_artifacts[i].second);
+
+        if (path.startsWith(root)) {
+            m_artifacts[i].second = prefix.isEmpty() ? path.mid(root.size()) : prefix + "/" + path.mid(root.size());
+        }
+    }
+}
+
+QByteArray ReplaySummary::toJson() const
+{
+    QByteArray json;
+
+    json += "{\n";
+    json += "  \"schema\": \"r4-replay-summary\",\n";
+    json += "  \"version\": " + QByteArray::number(VERSION) + ",\n";
+    json += "  \"result\": " + quote(m_result) + ",\n";
+    json += "  \"exit_reason\": " + quote(m_exitReason) + ",\n";
+    json += "  \"html_hash\": " + QByteArray::number(m_htmlHash) + ",\n";
+    json += "  \"schedule\": {\"size\": " + QByteArray::number(m_scheduleSize) +
+            ", \"executed\": " + QByteArray::number(m_scheduleExecuted) + "},\n";
+
+    json += "  \"mode_transitions\": [";
+    for (int i = 0; i < m_modeTransitions.size(); ++i) {
+        json += i == 0 ? "\n" : ",\n";
+        json += "    {\"mode\": " + quote(m_modeTransitions.at(i).first) +
+                ", \"schedule_index\": " + QByteArray::number(m_modeTransitions.at(i).second) + "}";
+    }
+    json += m_modeTransitions.isEmpty() ? "],\n" : "\n  ],\n";
+
+    json += "  \"counters\": {";
+    for (int i = 0; i < m_counters.size(); ++i) {
+        json += i == 0 ? "\n" : ",\n";
+        json += "    " + quote(m_counters.at(i).first) + ": " + QByteArray::number(m_counters.at(i).second);
+    }
+    json += m_counters.isEmpty() ? "},\n" : "\n  },\n";
+
+    json += "  \"timings_ms\": {";
+    for (int i = 0; i < m_timings.size(); ++i) {
+        json += i == 0 ? "\n" : ",\n";
+        json += "    " + quote(m_timings.at(i).first) + ": " + QByteArray::number(m_timings.at(i).second);
+    }
+    json += m_timings.isEmpty() ? "},\n" : "\n  },\n";
+
+    json += "  \"artifacts\": {";
+    for (int i = 0; i < m_artifacts.size(); ++i) {
+        json += i == 0 ? "\n" : ",\n";
+        json += "    " + quote(m_artifacts.at(i).first) + ": " + quote(m_artifacts.at(i).second);
+    }
+    json += m_artifacts.isEmpty() ? "}\n" : "\n  }\n";
+
+    json += "}\n";
+
+    return json;
+}
+
+bool ReplaySummary::write(const QString& path) const
+{
+    QString temporaryPath = path + ".tmp";
+
+    QFile fp(temporaryPath);
+    if (!fp.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        std::cerr << "Warning: Could not write " << temporaryPath.toStdString() << std::endl;
+        return false;
+    }
+
+    QByteArray json = toJson();
+    bool written = fp.write(json) == json.size() && fp.flush();
+    fp.close();
+
+    // rename() replaces an existing summary atomically (QFile::rename refuses to overwrite)
+    if (!written || std::rename(QFile::encodeName(temporaryPath).constData(), QFile::encodeName(path).constData()) != 0) {
+        std::cerr << "Warning: Could not write " << path.toStdString() << std::endl;
+        QFile::remove(temporaryPath);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef REPLAYSUMMARY_H
+#define REPLAYSUMMARY_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+/**
+ * Machine readable outcome of a replay (summary.json), written once at exit.
+ *
+ * The summary is a JSON object with a fixed schema name and version, such that readers can reject summaries they do
+ * not understand. It is written to a temporary file and renamed, thus readers never observe a partial summary.
+ *
+ * Version 1:
+ *   schema, version, result, exit_reason, html_hash,
+ *   schedule { size, executed },
+ *   mode_transitions [ { mode, schedule_index } ],
+ *   counters { name: count }, timings_ms { phase: ms }, artifacts { name: path }
+ */
+class ReplaySummary {
+
+public:
+    enum {
+        VERSION = 1
+    };
+
+    ReplaySummary();
+
+    void setResult(const QString& result, const QString& exitReason);
+    void setHtmlHash(uint htmlHash);
+    void setSchedule(unsigned int size, unsigned int executed);
+
+    void addModeTransition(const QString& mode, unsigned int scheduleIndex);
+    void setCounter(const QString& name, unsigned int value);
+    void setTiming(const QString& phase, qint64 miliseconds);
+    void addArtifact(const QString& name, const QString& path);
+
+    // Artifacts moved from directory into a container, paths become <prefix>/<file>
+    void relocateArtifacts(const QString& directory, const QString& prefix);
+
+    QByteArray toJson() const;
+    bool write(const QString& path) const;
+
+private:
+    QString m_result;
+    QString m_exitReason;
+    uint m_htmlHash;
+
+    unsigned int m_scheduleSize;
+    unsigned int m_scheduleExecuted;
+
+    QList<QPair<QString, unsigned int> > m_modeTransitions;
+    QList<QPair<QString, unsigned int> > m_counters;
+    QList<QPair<QString, qint64> > m_timings;
+    QList<QPair<QString, QString> > m_artifacts;
+};
+
+#endif // REPLAYSUMMARY_H
@@ -0,0 +1,203 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <QPainter>
+#include <QPen>
+#include <QVector>
+
+#include "screenshotdiff.h"
+
+namespace {
+
+// Mean absolute difference per channel (0-255) before a block is considered changed
+const double blockThreshold = 2.0;
+
+}
+
+ScreenshotDiff::ScreenshotDiff()
+    : m_valid(false)
+    , m_sameSize(false)
+    , m_distance(-1)
+    , m_changedBlocks(0)
+    , m_blocks(0)
+{
+}
+
+ScreenshotDiff ScreenshotDiff::compare(const QImage& baselineImage, const QImage& replayImage, int blockSize)
+{
+    ScreenshotDiff diff;
+
+    if (baselineImage.isNull() || replayImage.isNull()) {
+        return diff;
+    }
+
+    QImage baseline = baselineImage.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage image = replayImage.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    int width = std::min(baseline.width(), image.width());
+    int height = std::min(baseline.height(), image.height());
+
+    diff.m_valid = true;
+    diff.m_sameSize = baseline.size() == image.size();
+    diff.m_size = image.size();
+
+    int blocksX = (width + blockSize - 1) / blockSize;
+    int blocksY = (height + blockSize - 1) / blockSize;
+
+    QVector<quint64> blockDifference(blocksX * blocksY, 0);
+    double squared = 0;
+
+    for (int y = 0; y < height; ++y) {
+        const QRgb* baselineLine = reinterpret_cast<const QRgb*>(baseline.constScanLine(y));
+        const QRgb* imageLine = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        quint64* blockLine = blockDifference.data() + (y / blockSize) * blocksX;
+
+        for (int x = 0; x < width; ++x) {
+            QRgb a = baselineLine[x];
+            QRgb b = imageLine[x];
+
+            if (a == b) {
+                continue;
+            }
+
+            int dr = qRed(a) - qRed(b);
+            int dg = qGreen(a) - qGreen(b);
+            int db = qBlue(a) - qBlue(b);
+            int da = qAlpha(a) - qAlpha(b);
+
+            squared += dr * dr + dg * dg + db * db + da * da;
+            blockLine[x / blockSize] += std::abs(dr) + std::abs(dg) + std::abs(db) + std::abs(da);
+        }
+    }
+
+    diff.m_blocks = blocksX * blocksY;
+
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            QRect block(bx * blockSize, by * blockSize, blockSize, blockSize);
+            block &= QRect(0, 0, width, height);
+
+            double mean = blockDifference.at(by * blocksX + bx) / (4.0 * block.width() * block.height());
+
+            if (mean >= blockThreshold) {
+                diff.m_changedRegion |= block;
+                diff.m_changedBlocks++;
+            }
+        }
+    }
+
+    // Everything outside the common region is changed
+    if (!diff.m_sameSize) {
+        QRect all(QPoint(0, 0), baseline.size().expandedTo(image.size()));
+
+        if (all.width() > width) {
+            diff.m_changedRegion |= QRect(width, 0, all.width() - width, all.height());
+        }
+
+        if (all.height() > height) {
+            diff.m_changedRegion |= QRect(0, height, all.width(), all.height() - height);
+        }
+    }
+
+    double pixels = (double)width * height;
+    diff.m_distance = pixels > 0 ? std::sqrt(squared / (4.0 * pixels)) * (65535.0 / 255.0) : 0;
+
+    return diff;
+}
+
+/**
+ * The report only classifies a comparison as EXACT if the distance reads as 0, thus a non-zero distance must never be
+ * rounded down to 0. The smallest non-zero distance of an image with n pixels is about 128/sqrt(n).
+ */
+static QByteArray formatDistance(double distance)
+{
+    static const double resolution = 0.000001;
+
+    if (distance > 0 && distance < resolution) {
+        distance = resolution;
+    }
+
+    return QByteArray::number(distance, 'f', 6);
+}
+
+QString ScreenshotDiff::matchType() const
+{
+    if (!m_valid) {
+        return QString::fromAscii("error");
+    }
+
+    return QString::fromAscii(m_sameSize ? "normal" : "subimage");
+}
+
+QByteArray ScreenshotDiff::comparisonMeta() const
+{
+    return formatDistance(m_distance) + matchType().toAscii();
+}
+
+QByteArray ScreenshotDiff::summary() const
+{
+    QByteArray summary;
+
+    summary += "Match: " + matchType().toAscii() + "\n";
+    summary += "Distance: " + formatDistance(m_distance) + "\n";
+    summary += "Size: " + QByteArray::number(m_size.width()) + "x" + QByteArray::number(m_size.height()) + "\n";
+    summary += "Changed-blocks: " + QByteArray::number(m_changedBlocks) + "/" + QByteArray::number(m_blocks) + "\n";
+
+    if (m_changedRegion.isEmpty()) {
+        summary += "Changed-region: none\n";
+    } else {
+        summary += "Changed-region: " + QByteArray::number(m_changedRegion.x()) + "," + QByteArray::number(m_changedRegion.y()) +
+                   " " + QByteArray::number(m_changedRegion.width()) + "x" + QByteArray::number(m_changedRegion.height()) + "\n";
+    }
+
+    return summary;
+}
+
+QImage ScreenshotDiff::thumbnail(const QImage& image, int maxWidth) const
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    double scale = image.width() > maxWidth ? (double)maxWidth / image.width() : 1.0;
+    QImage thumbnail = image.scaledToWidth(std::max(1, (int)(image.width() * scale)), Qt::SmoothTransformation);
+
+    if (!m_changedRegion.isEmpty()) {
+        QRect region((int)std::floor(m_changedRegion.x() * scale), (int)std::floor(m_changedRegion.y() * scale),
+                     (int)std::ceil(m_changedRegion.width() * scale), (int)std::ceil(m_changedRegion.height() * scale));
+
+        QPainter p(&thumbnail);
+        p.setPen(QPen(Qt::red, 1));
+        p.drawRect(region.adjusted(0, 0, -1, -1));
+        p.end();
+    }
+
+    return thumbnail;
+}
@@ -0,0 +1,86 @@
+/*
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SCREENSHOTDIFF_H
+#define SCREENSHOTDIFF_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+/**
+ * Compares a replay screenshot with the screenshot of a baseline replay, directly on the rendered image.
+ *
+ * The distance is the RMSE over all channels, on the 16-bit scale reported by ImageMagick's compare, thus it is 0 only
+ * for identical images. The changed region is the bounding box of the blocks whose mean difference is noticeable, such
+ * that antialiasing noise does not spread it over the whole page.
+ *
+ * Screenshots of different sizes are compared on their common top-left region and reported as a subimage match
+ * (an approximation of compare -subimage-search, which searches for the best offset).
+ */
+class ScreenshotDiff {
+
+public:
+    ScreenshotDiff();
+
+    static ScreenshotDiff compare(const QImage& baseline, const QImage& image, int blockSize = 16);
+
+    bool isValid() const {
+        return m_valid;
+    }
+
+    double distance() const {
+        return m_distance;
+    }
+
+    const QRect& changedRegion() const {
+        return m_changedRegion;
+    }
+
+    // "normal", "subimage" or "error", as used by utils/batch-report
+    QString matchType() const;
+
+    // Contents of comparison.txt, as read by utils/batch-report
+    QByteArray comparisonMeta() const;
+
+    // Human readable summary (distance, size, changed region and blocks)
+    QByteArray summary() const;
+
+    // The image scaled to at most maxWidth pixels wide, with the changed region outlined
+    QImage thumbnail(const QImage& image, int maxWidth = 256) const;
+
+private:
+    bool m_valid;
+    bool m_sameSize;
+    double m_distance;
+    QSize m_size;
+    QRect m_changedRegion;
+    int m_changedBlocks;
+    int m_blocks;
+};
+
+#endif // SCREENSHOTDIFF_H
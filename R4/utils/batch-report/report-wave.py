@@ -4,6 +4,7 @@ import sys
 import os
 import difflib
 import re
+import json
 import shutil
 from jinja2 import Environment, PackageLoader
 import subprocess
@@ -340,6 +341,8 @@ def parse_race(base_dir, handle):
     errors = []
     exceptions = []
     new_events = []
+    suppressed = {}  # (module, short description) -> warnings dropped by the exemplar limit
+    suppressed_exceptions = {}  # the same, for the kinds exceptions are read from
 
     num_new_events = 0
     num_skipped_events = 0
@@ -364,6 +367,21 @@ def parse_race(base_dir, handle):
             else:
                 details = fp.read(length).decode('utf8', 'ignore')
 
+            if 'WEBERA_WARNINGS' in module and 'Suppressed warnings.' in description:
+                # Warnings dropped by the exemplar limit, <count>;<module>;<short description>
+                count, suppressed_module, suppressed_description = details.strip().split(';', 2)
+
+                if 'Non-executed event action' in suppressed_description:
+                    num_new_events += int(count)
+
+                if ('JavaScript_Interpreter' in suppressed_module and 'An exception occured' in suppressed_description) or \
+                   ('console.log' in suppressed_module and 'ERROR' in suppressed_description):
+                    suppressed_exceptions[(suppressed_module, suppressed_description)] = int(count)
+                elif 'console.log' not in suppressed_module:
+                    suppressed[(suppressed_module, suppressed_description)] = int(count)
+
+                continue
+
             container = errors
             t = 'error'
 
@@ -406,23 +424,47 @@ def parse_race(base_dir, handle):
                 _ignore_properties=['event_action_id', 'type']
             ))
 
-    # STDOUT
+    # SUMMARY
 
-    stdout_file = os.path.join(handle_dir, 'stdout')
-    if not os.path.exists(stdout_file):
-        stdout_file = os.path.join(handle_dir, 'stdout.txt')
+    result = None
+    html_state = None
+    schedule_executed = None
 
-    with open(stdout_file, 'rb') as fp:
-        stdout = fp.read().decode('utf8', 'ignore')
+    summary_file = os.path.join(handle_dir, 'out.summary.json')
+
+    if os.path.exists(summary_file):
+        with open(summary_file, 'r') as fp:
+            replay_summary = json.load(fp)
+
+        if replay_summary.get('schema') == 'r4-replay-summary' and replay_summary.get('version') == 1:
+            result = replay_summary['result']
+            html_state = str(replay_summary['html_hash'])
+            schedule_executed = replay_summary['schedule']['executed']
+        else:
+            print('Warning, unknown summary version in file:', summary_file)
+
+    # STDOUT (replays without a summary)
+
+    if result is None:
+
+        stdout_file = os.path.join(handle_dir, 'stdout')
+        if not os.path.exists(stdout_file):
+            stdout_file = os.path.join(handle_dir, 'stdout.txt')
+
+        with open(stdout_file, 'rb') as fp:
+            stdout = fp.read().decode('utf8', 'ignore')
+
+        result_match = re.compile('Result: ([A-Z]+)').search(stdout)
+        state_match = re.compile('HTML-hash: ([0-9]+)').search(stdout)
 
-    result_match = re.compile('Result: ([A-Z]+)').search(stdout)
-    state_match = re.compile('HTML-hash: ([0-9]+)').search(stdout)
+        if result_match is None:
+            print('Warning, result not found in file:', stdout_file)
 
-    if result_match is None:
-        print('Warning, result not found in file:', stdout_file)
+        if state_match is None:
+            print('Warning, state not found in file:', stdout_file)
 
-    if state_match is None:
-        print('Warning, state not found in file:', stdout_file)
+        result = result_match.group(1) if result_match is not None else 'ERROR'
+        html_state = state_match.group(1) if state_match is not None else 'ERROR'
 
     # Origin
 
@@ -444,6 +486,7 @@ def parse_race(base_dir, handle):
         output_schedule_file = os.path.join(handle_dir, 'schedule.data')
 
     schedule = []
+    scheduled_ids = []  # event action id at each schedule index, -1 for markers
     raceFirst = ""
     raceFirstIndex = -1
     raceSecond = ""
@@ -485,6 +528,7 @@ def parse_race(base_dir, handle):
                     raceSecond = (event_action_id, event_action_descriptor)
                     raceSecondIndex = index
 
+            scheduled_ids.append(event_action_id)
             index += 1
 
     output_race_first = None
@@ -584,10 +628,14 @@ def parse_race(base_dir, handle):
         'handle': handle,
         'errors': errors,
         'exceptions': exceptions,
+        'suppressed': suppressed,
+        'suppressed_exceptions': suppressed_exceptions,
         'schedule': schedule,
         'zip_errors_schedule': zip_errors_schedule,
-        'result': result_match.group(1) if result_match is not None else 'ERROR',
-        'html_state': state_match.group(1) if state_match is not None else 'ERROR',
+        'result': result,
+        'schedule_executed': schedule_executed,
+        'scheduled_ids': scheduled_ids,
+        'html_state': html_state,
         'race_dir': handle_dir,
         'origin': origin,
         'raceFirst': raceFirst,
@@ -687,6 +735,24 @@ def cimage_human(type, distance):
         return 'ERROR'
 
 
+def before_convergence(base_data, race_data, items):
+    """
+    Baseline errors or exceptions produced before the schedule index at which the race converged
+
+    The baseline executes the remaining suffix as the race would have, thus items of event actions scheduled from that
+    index on are not compared. Items outside the scheduled event actions are kept.
+    """
+
+    index = race_data['schedule_executed']
+    if index is None:
+        return items
+
+    prefix = set(base_data['scheduled_ids'][:index])
+    suffix = set(base_data['scheduled_ids'][index:]) - prefix
+
+    return [item for item in items if item['event_action_id'] not in suffix]
+
+
 def compare_race(base_data, race_data, namespace):
     """
     Outputs comparison
@@ -749,11 +815,18 @@ def compare_race(base_data, race_data, namespace):
 
         return base_list, race_list
 
+    # A converged replay stopped early, as its DOM and pending event actions matched the baseline at the same schedule
+    # index. Its errors are compared with those of the baseline up to that index, and its final state is not comparable.
+    converged = race_data['result'] == 'CONVERGED'
+
     # Errors diff
 
     base_errors = base_data['errors']
     race_errors = race_data['errors']
 
+    if converged:
+        base_errors = before_convergence(base_data, race_data, base_errors)
+
     base_errors, race_errors = remove_new_event_action(base_errors, race_errors)
 
     diff = difflib.SequenceMatcher(None, base_errors, race_errors)
@@ -771,11 +844,20 @@ def compare_race(base_data, race_data, namespace):
 
     errors_distance = sum(1 for opcode in opcodes if opcode[0] != 'equal')
 
+    # Kinds whose warnings were dropped by the exemplar limit differ if their counts differ. A converged race stopped
+    # early, thus its counts are not comparable.
+    if not converged:
+        errors_distance += sum(1 for kind in set(base_data['suppressed']) | set(race_data['suppressed'])
+                               if base_data['suppressed'].get(kind, 0) != race_data['suppressed'].get(kind, 0))
+
     # Exceptions diff
 
     base_exceptions = base_data['exceptions']
     race_exceptions = race_data['exceptions']
 
+    if converged:
+        base_exceptions = before_convergence(base_data, race_data, base_exceptions)
+
     exceptions_diff = difflib.SequenceMatcher(None, base_exceptions, race_exceptions)
     exceptions_opcodes = exceptions_diff.get_opcodes()
     exceptions_opcodes_human = []
@@ -791,6 +873,11 @@ def compare_race(base_data, race_data, namespace):
 
     exceptions_distance = sum(1 for opcode in exceptions_opcodes if opcode[0] != 'equal')
 
+    # Exceptions beyond the exemplar limit are only counted, compare their counts as for errors
+    if not converged:
+        exceptions_distance += sum(1 for kind in set(base_data['suppressed_exceptions']) | set(race_data['suppressed_exceptions'])
+                                   if base_data['suppressed_exceptions'].get(kind, 0) != race_data['suppressed_exceptions'].get(kind, 0))
+
     exceptions_set_comparison = \
         set(['%s%s' % (base_exception['description'], base_exception['details']) for base_exception in base_exceptions]) == \
         set(['%s%s' % (base_exception['description'], base_exception['details']) for base_exception in race_exceptions])
@@ -832,6 +919,9 @@ def compare_race(base_data, race_data, namespace):
     classification = 'NORMAL'
     classification_details = ""
 
+    if converged:
+        classification_details += 'R4_CONVERGED '
+
     # Low triggers
 
     # High triggers (classifiers)
@@ -840,7 +930,7 @@ def compare_race(base_data, race_data, namespace):
         classification = 'HIGH'
         classification_details += 'R4_EXCEPTIONS '
 
-    if not visual_state_match and not html_state_match:
+    if not converged and not visual_state_match and not html_state_match:
         classification = 'HIGH'
         classification_details += 'R4_DOM_AND_RENDER_MISMATCH '
 
@@ -896,7 +986,8 @@ def compare_race(base_data, race_data, namespace):
         'zip_diff_has_unequal': unequal_seen,
         'html_state_match': html_state_match,
         'visual_state_match': cimage,
-        'is_equal': base_data['html_state'] == race_data['html_state'] and schedule_distance == 0 and exceptions_distance == 0,
+        'is_equal': not converged and html_state_match and schedule_distance == 0 and exceptions_distance == 0,
+        'no_observed_difference': converged and exceptions_distance == 0,
         'r4_classification': classification,
         'r4_classification_details': classification_details
     }
@@ -976,6 +1067,7 @@ def output_website_index(website_index, output_dir, input_dir):
     summary = {
         'race_result': {
             'equal': 0,
+            'converged': 0,
             'diff': 0,
             'timeout': 0,
             'error': 0
@@ -1007,6 +1099,7 @@ def output_website_index(website_index, output_dir, input_dir):
             continue
 
         summary['race_result']['equal'] += item['summary']['equal']
+        summary['race_result']['converged'] += item['summary'].get('converged', 0)
         summary['race_result']['diff'] += item['summary']['diff']
         summary['race_result']['timeout'] += item['summary']['timeout']
         summary['race_result']['error'] += item['summary']['error']
@@ -1068,7 +1161,7 @@ def process(job):
         print('Error, missing base or record directory in output dir for %s' % website)
         return None
 
-    ignore_files = ['runner', 'record.png', 'arcs.log', 'out.schedule.data', 'new_schedule.data', 'stdout.txt', 'out.ER_actionlog', 'out.log.network.data', 'out.log.time.data', 'out.log.random.data', 'out.status.data']
+    ignore_files = ['runner', 'record.png', 'arcs.log', 'out.schedule.data', 'new_schedule.data', 'stdout.txt', 'out.ER_actionlog', 'out.log.network.data', 'out.log.network.data.index', 'out.log.time.data', 'out.log.random.data', 'out.status.data', 'out.summary.json']
 
     races = [race for race in races if not race.startswith('_') and not race in ignore_files]
 
@@ -1187,7 +1280,9 @@ def process(job):
 
     summary = {
         'equal': len([race for race in parsed_races if race['race_data']['result'] == 'FINISHED' and race['comparison']['is_equal']]),
-        'diff': len([race for race in parsed_races if race['race_data']['result'] == 'FINISHED' and not race['comparison']['is_equal']]),
+        'converged': len([race for race in parsed_races if race['race_data']['result'] == 'CONVERGED' and race['comparison']['no_observed_difference']]),
+        'diff': len([race for race in parsed_races if race['race_data']['result'] == 'FINISHED' and not race['comparison']['is_equal'] or
+                     race['race_data']['result'] == 'CONVERGED' and not race['comparison']['no_observed_difference']]),
         'timeout': len([race for race in parsed_races if race['race_data']['result'] == 'TIMEOUT']),
         'error': len([race for race in parsed_races if race['race_data']['result'] == 'ERROR']),
         'er_high': len([race for race in parsed_races if race['race_data']['er_classification'] == 'HIGH']),
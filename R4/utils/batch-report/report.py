@@ -338,6 +338,8 @@ def parse_race(base_dir, handle):
     errors = []
     exceptions = []
     new_events = []
+    suppressed = {}  # (module, short description) -> warnings dropped by the exemplar limit
+    suppressed_exceptions = {}  # the same, for the kinds exceptions are read from
 
     num_new_events = 0
     num_skipped_events = 0
@@ -362,6 +364,21 @@ def parse_race(base_dir, handle):
             else:
                 details = fp.read(length).decode('utf8', 'ignore')
 
+            if 'WEBERA_WARNINGS' in module and 'Suppressed warnings.' in description:
+                # Warnings dropped by the exemplar limit, <count>;<module>;<short description>
+                count, suppressed_module, suppressed_description = details.strip().split(';', 2)
+
+                if 'Non-executed event action' in suppressed_description:
+                    num_new_events += int(count)
+
+                if ('JavaScript_Interpreter' in suppressed_module and 'An exception occured' in suppressed_description) or \
+                   ('console.log' in suppressed_module and 'ERROR' in suppressed_description):
+                    suppressed_exceptions[(suppressed_module, suppressed_description)] = int(count)
+                elif 'console.log' not in suppressed_module:
+                    suppressed[(suppressed_module, suppressed_description)] = int(count)
+
+                continue
+
             container = errors
             t = 'error'
 
@@ -404,23 +421,47 @@ def parse_race(base_dir, handle):
                 _ignore_properties=['event_action_id', 'type']
             ))
 
-    # STDOUT
+    # SUMMARY
 
-    stdout_file = os.path.join(handle_dir, 'stdout')
-    if not os.path.exists(stdout_file):
-        stdout_file = os.path.join(handle_dir, 'stdout.txt')
+    result = None
+    html_state = None
+    schedule_executed = None
 
-    with open(stdout_file, 'rb') as fp:
-        stdout = fp.read().decode('utf8', 'ignore')
+    summary_file = os.path.join(handle_dir, 'out.summary.json')
+
+    if os.path.exists(summary_file):
+        with open(summary_file, 'r') as fp:
+            replay_summary = simplejson.load(fp)
+
+        if replay_summary.get('schema') == 'r4-replay-summary' and replay_summary.get('version') == 1:
+            result = replay_summary['result']
+            html_state = str(replay_summary['html_hash'])
+            schedule_executed = replay_summary['schedule']['executed']
+        else:
+            print('Warning, unknown summary version in file:', summary_file)
+
+    # STDOUT (replays without a summary)
+
+    if result is None:
+
+        stdout_file = os.path.join(handle_dir, 'stdout')
+        if not os.path.exists(stdout_file):
+            stdout_file = os.path.join(handle_dir, 'stdout.txt')
+
+        with open(stdout_file, 'rb') as fp:
+            stdout = fp.read().decode('utf8', 'ignore')
+
+        result_match = re.compile('Result: ([A-Z]+)').search(stdout)
+        state_match = re.compile('HTML-hash: ([0-9]+)').search(stdout)
 
-    result_match = re.compile('Result: ([A-Z]+)').search(stdout)
-    state_match = re.compile('HTML-hash: ([0-9]+)').search(stdout)
+        if result_match is None:
+            print('Warning, result not found in file:', stdout_file)
 
-    if result_match is None:
-        print('Warning, result not found in file:', stdout_file)
+        if state_match is None:
+            print('Warning, state not found in file:', stdout_file)
 
-    if state_match is None:
-        print('Warning, state not found in file:', stdout_file)
+        result = result_match.group(1) if result_match is not None else 'ERROR'
+        html_state = state_match.group(1) if state_match is not None else 'ERROR'
 
     # Origin
 
@@ -440,6 +481,7 @@ def parse_race(base_dir, handle):
         output_schedule_file = os.path.join(handle_dir, 'schedule.data')
 
     schedule = []
+    scheduled_ids = []  # event action id at each schedule index, -1 for markers
     raceFirst = ""
     raceFirstIndex = -1
     raceSecond = ""
@@ -481,6 +523,7 @@ def parse_race(base_dir, handle):
                     raceSecond = (event_action_id, event_action_descriptor)
                     raceSecondIndex = index
 
+            scheduled_ids.append(event_action_id)
             index += 1
 
     output_race_first = None
@@ -580,10 +623,14 @@ def parse_race(base_dir, handle):
         'handle': handle,
         'errors': errors,
         'exceptions': exceptions,
+        'suppressed': suppressed,
+        'suppressed_exceptions': suppressed_exceptions,
 #        'schedule': schedule,
         'zip_errors_schedule': zip_errors_schedule,
-        'result': result_match.group(1) if result_match is not None else 'ERROR',
-        'html_state': state_match.group(1) if state_match is not None else 'ERROR',
+        'result': result,
+        'schedule_executed': schedule_executed,
+        'scheduled_ids': scheduled_ids,
+        'html_state': html_state,
         'race_dir': handle_dir,
         'origin': origin,
         'raceFirst': raceFirst,
@@ -683,6 +730,24 @@ def cimage_human(type, distance):
         return 'ERROR'
 
 
+def before_convergence(base_data, race_data, items):
+    """
+    Baseline errors or exceptions produced before the schedule index at which the race converged
+
+    The baseline executes the remaining suffix as the race would have, thus items of event actions scheduled from that
+    index on are not compared. Items outside the scheduled event actions are kept.
+    """
+
+    index = race_data['schedule_executed']
+    if index is None:
+        return items
+
+    prefix = set(base_data['scheduled_ids'][:index])
+    suffix = set(base_data['scheduled_ids'][index:]) - prefix
+
+    return [item for item in items if item['event_action_id'] not in suffix]
+
+
 def compare_race(base_data, race_data, namespace):
     """
     Outputs comparison
@@ -745,11 +810,18 @@ def compare_race(base_data, race_data, namespace):
 
         return base_list, race_list
 
+    # A converged replay stopped early, as its DOM and pending event actions matched the baseline at the same schedule
+    # index. Its errors are compared with those of the baseline up to that index, and its final state is not comparable.
+    converged = race_data['result'] == 'CONVERGED'
+
     # Errors diff
 
     base_errors = base_data['errors']
     race_errors = race_data['errors']
 
+    if converged:
+        base_errors = before_convergence(base_data, race_data, base_errors)
+
     base_errors, race_errors = remove_new_event_action(base_errors, race_errors)
 
     diff = difflib.SequenceMatcher(None, base_errors, race_errors)
@@ -767,11 +839,20 @@ def compare_race(base_data, race_data, namespace):
 
     errors_distance = sum(1 for opcode in opcodes if opcode[0] != 'equal')
 
+    # Kinds whose warnings were dropped by the exemplar limit differ if their counts differ. A converged race stopped
+    # early, thus its counts are not comparable.
+    if not converged:
+        errors_distance += sum(1 for kind in set(base_data['suppressed']) | set(race_data['suppressed'])
+                               if base_data['suppressed'].get(kind, 0) != race_data['suppressed'].get(kind, 0))
+
     # Exceptions diff
 
     base_exceptions = base_data['exceptions']
     race_exceptions = race_data['exceptions']
 
+    if converged:
+        base_exceptions = before_convergence(base_data, race_data, base_exceptions)
+
     exceptions_diff = difflib.SequenceMatcher(None, base_exceptions, race_exceptions)
     exceptions_opcodes = exceptions_diff.get_opcodes()
     exceptions_opcodes_human = []
@@ -787,6 +868,11 @@ def compare_race(base_data, race_data, namespace):
 
     exceptions_distance = sum(1 for opcode in exceptions_opcodes if opcode[0] != 'equal')
 
+    # Exceptions beyond the exemplar limit are only counted, compare their counts as for errors
+    if not converged:
+        exceptions_distance += sum(1 for kind in set(base_data['suppressed_exceptions']) | set(race_data['suppressed_exceptions'])
+                                   if base_data['suppressed_exceptions'].get(kind, 0) != race_data['suppressed_exceptions'].get(kind, 0))
+
     exceptions_set_comparison = \
         set(['%s%s' % (base_exception['description'], base_exception['details']) for base_exception in base_exceptions]) == \
         set(['%s%s' % (base_exception['description'], base_exception['details']) for base_exception in race_exceptions])
@@ -828,6 +914,9 @@ def compare_race(base_data, race_data, namespace):
     classification = 'NORMAL'
     classification_details = ""
 
+    if converged:
+        classification_details += 'R4_CONVERGED '
+
     if race_data['output_race_first'] is None or \
        race_data['output_race_second'] is None:
         print('Warning, %s/%s has no race output' % (base_data['race_dir'], base_data['handle']))
@@ -850,7 +939,7 @@ def compare_race(base_data, race_data, namespace):
 
         # Flags
 
-        if visual_state_match and html_state_match and not equal:
+        if not converged and visual_state_match and html_state_match and not equal:
             classification_details += 'R4_HEAP_MISMATCH '
 
         # Low triggers
@@ -861,7 +950,7 @@ def compare_race(base_data, race_data, namespace):
             classification = 'HIGH'
             classification_details += 'R4_EXCEPTIONS '
 
-        if not visual_state_match and not html_state_match:
+        if not converged and not visual_state_match and not html_state_match:
             classification = 'HIGH'
             classification_details += 'R4_DOM_AND_RENDER_MISMATCH '
 
@@ -968,7 +1057,8 @@ def compare_race(base_data, race_data, namespace):
         'zip_diff_has_unequal': unequal_seen,
         'html_state_match': html_state_match,
         'visual_state_match': cimage,
-        'is_equal': base_data['html_state'] == race_data['html_state'] and 'human' in cimage and cimage['human'] == 'EXACT' and errors_distance == 0 and exceptions_distance == 0,
+        'is_equal': not converged and html_state_match and visual_state_match and errors_distance == 0 and exceptions_distance == 0,
+        'no_observed_difference': converged and errors_distance == 0 and exceptions_distance == 0,
         'r4_classification': classification,
         'r4_classification_details': classification_details
     }
@@ -1050,6 +1140,7 @@ def output_website_index(websites, output_dir, input_dir):
     summary = {
         'race_result': {
             'equal': 0,
+            'converged': 0,
             'diff': 0,
             'timeout': 0,
             'error': 0
@@ -1083,6 +1174,7 @@ def output_website_index(websites, output_dir, input_dir):
                 item['website'] = website
                 
             summary['race_result']['equal'] += item['summary']['equal']
+            summary['race_result']['converged'] += item['summary'].get('converged', 0)
             summary['race_result']['diff'] += item['summary']['diff']
             summary['race_result']['timeout'] += item['summary']['timeout']
             summary['race_result']['error'] += item['summary']['error']
@@ -1172,7 +1264,7 @@ def process(job):
         print('Error, missing base or record directory in output dir for %s' % website)
         return None
 
-    ignore_files = ['runner', 'record.png', 'arcs.log', 'out.schedule.data', 'new_schedule.data', 'stdout.txt', 'out.ER_actionlog', 'out.log.network.data', 'out.log.time.data', 'out.log.random.data', 'out.status.data']
+    ignore_files = ['runner', 'record.png', 'arcs.log', 'out.schedule.data', 'new_schedule.data', 'stdout.txt', 'out.ER_actionlog', 'out.log.network.data', 'out.log.network.data.index', 'out.log.time.data', 'out.log.random.data', 'out.status.data', 'out.summary.json']
 
     races = [race for race in races if not race.startswith('_') and not race in ignore_files]
 
@@ -1185,6 +1277,7 @@ def process(job):
         'website': website,
         'count': 0,
         'equal': 0,
+        'converged': 0,
         'diff': 0,
         'timeout': 0,
         'error': 0,
@@ -1233,7 +1326,9 @@ def process(job):
         summary['count'] += 1
 
         summary['equal'] += 1 if prace['race_data']['result'] == 'FINISHED' and prace['comparison']['is_equal'] else 0
-        summary['diff'] += 1 if prace['race_data']['result'] == 'FINISHED' and not prace['comparison']['is_equal'] else 0
+        summary['converged'] += 1 if prace['race_data']['result'] == 'CONVERGED' and prace['comparison']['no_observed_difference'] else 0
+        summary['diff'] += 1 if prace['race_data']['result'] == 'FINISHED' and not prace['comparison']['is_equal'] or \
+                                prace['race_data']['result'] == 'CONVERGED' and not prace['comparison']['no_observed_difference'] else 0
         summary['timeout'] += 1 if prace['race_data']['result'] == 'TIMEOUT' else 0
         summary['error'] += 1 if prace['race_data']['result'] == 'ERROR' else 0
         summary['er_high'] += 1 if prace['race_data']['er_classification'] == 'HIGH' else 0
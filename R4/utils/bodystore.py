@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+
+"""
+Reference counting and garbage collection for network body stores, written with record -body_store <dir> (replay
+only reads the store, its network logs keep their bodies).
+
+The store contains objects/<2 hex>/<62 hex>, the bodies named by their SHA-256, and refs/<name>, one file for each
+network log referencing the store ("log <path>", followed by one hash per line). The reference count of a body is the
+number of refs files listing it.
+
+gc first releases the references of network logs which no longer exist, and then removes unreferenced bodies (and
+left over temporary files) not modified within the grace period, such that recordings running concurrently keep the
+bodies they are storing.
+
+Usage: bodystore.py stats <store>
+       bodystore.py refs <store>
+       bodystore.py release <store> <log.network.data>...
+       bodystore.py gc [--dry-run] [--grace <seconds>] <store>
+"""
+
+import os
+import sys
+import time
+
+DEFAULT_GRACE = 3600
+
+
+def read_refs(store):
+    """
+    Returns (refs path, log path, set of hashes) of each network log referencing the store.
+    """
+
+    refs = []
+    refs_dir = os.path.join(store, 'refs')
+
+    for name in sorted(os.listdir(refs_dir)):
+        path = os.path.join(refs_dir, name)
+        log = None
+        hashes = set()
+
+        with open(path, 'r') as fp:
+            for line in fp:
+                line = line.rstrip('\n')
+
+                if line.startswith('log '):
+                    log = line[4:]
+                elif len(line) == 64:
+                    hashes.add(line)
+
+        refs.append((path, log, hashes))
+
+    return refs
+
+
+def list_objects(store):
+    """
+    Returns (hash or None for temporary files, path, size, mtime) of each file in the object directory.
+    """
+
+    objects = []
+    objects_dir = os.path.join(store, 'objects')
+
+    for prefix in sorted(os.listdir(objects_dir)):
+        prefix_dir = os.path.join(objects_dir, prefix)
+
+        for name in sorted(os.listdir(prefix_dir)):
+            path = os.path.join(prefix_dir, name)
+            stat = os.stat(path)
+
+            digest = prefix + name
+            if len(digest) != 64:
+                digest = None
+
+            objects.append((digest, path, stat.st_size, stat.st_mtime))
+
+    return objects
+
+
+def reference_counts(refs):
+    counts = {}
+
+    for _path, _log, hashes in refs:
+        for digest in hashes:
+            counts[digest] = counts.get(digest, 0) + 1
+
+    return counts
+
+
+def stats(store):
+    refs = read_refs(store)
+    objects = list_objects(store)
+    counts = reference_counts(refs)
+
+    stored = 0
+    unreferenced = 0
+    unreferenced_size = 0
+    shared_size = 0
+
+    for digest, _path, size, _mtime in objects:
+        if digest is None:
+            continue
+
+        stored += size
+        count = counts.get(digest, 0)
+
+        if count == 0:
+            unreferenced += 1
+            unreferenced_size += size
+        else:
+            shared_size += count * size
+
+    print('Network logs: %d' % len(refs))
+    print('Bodies: %d (%d bytes)' % (len([o for o in objects if o[0] is not None]), stored))
+    print('Unreferenced bodies: %d (%d bytes)' % (unreferenced, unreferenced_size))
+    print('Bytes referenced by all network logs: %d' % shared_size)
+
+
+def list_refs(store):
+    for path, log, hashes in read_refs(store):
+        state = '' if log is not None and os.path.exists(log) else ' (missing)'
+        print('%s %d %s%s' % (os.path.basename(path), len(hashes), log, state))
+
+
+def release(store, logs):
+    logs = set(os.path.abspath(log) for log in logs)
+
+    for path, log, _hashes in read_refs(store):
+        if log is not None and os.path.abspath(log) in logs:
+            os.remove(path)
+            print('Released %s' % log)
+
+
+def gc(store, dry_run, grace):
+    now = time.time()
+
+    refs = []
+    for path, log, hashes in read_refs(store):
+        if log is None or not os.path.exists(log):
+            print('Releasing %s' % log)
+            if not dry_run:
+                os.remove(path)
+        else:
+            refs.append((path, log, hashes))
+
+    counts = reference_counts(refs)
+
+    removed = 0
+    removed_size = 0
+
+    for digest, path, size, mtime in list_objects(store):
+        if digest is not None and counts.get(digest, 0) > 0:
+            continue
+
+        if now - mtime < grace:
+            continue  # possibly being stored by a running recording
+
+        removed += 1
+        removed_size += size
+
+        if not dry_run:
+            os.remove(path)
+
+    print('%s %d unreferenced files (%d bytes)' % ('Would remove' if dry_run else 'Removed', removed, removed_size))
+
+
+if __name__ == '__main__':
+
+    dry_run = False
+    if '--dry-run' in sys.argv:
+        dry_run = True
+        sys.argv.remove('--dry-run')
+
+    grace = DEFAULT_GRACE
+    if '--grace' in sys.argv:
+        index = sys.argv.index('--grace')
+        grace = int(sys.argv[index + 1])
+        del sys.argv[index:index + 2]
+
+    if len(sys.argv) < 3 or sys.argv[1] not in ('stats', 'refs', 'release', 'gc'):
+        print(__doc__.strip().split('\n\n')[-1])
+        sys.exit(1)
+
+    command, store = sys.argv[1], sys.argv[2]
+
+    if command == 'stats':
+        stats(store)
+    elif command == 'refs':
+        list_refs(store)
+    elif command == 'release':
+        release(store, sys.argv[3:])
+    else:
+        gc(store, dry_run, grace)
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+
+"""
+Records each page in R4/examples under each specification scheduler policy (R4/clients/Record/policies/*.policy) and
+checks the order in which the scheduler picked event actions against the policy.
+
+Each recording runs with -specification-trace, such that the scheduler writes every event action scheduled,
+descheduled, picked and executed to a trace file. For every executed event action we know the event actions that were
+pending when it was picked, and assert:
+
+ - no pending event action of a queue ordered before its own queue (e.g. parsing before network) was passed over
+ - once a network request of a finish-sequences queue has started, its pending event actions run before anything else
+
+Usage: check-policies.py [--verbose] [--policy <file>] [<page>...]
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+from collections import Counter
+
+CATEGORIES = {
+    '@OTHER': 0,
+    '@TIMER': 1,
+    '@USER_INTERFACE': 2,
+    '@NETWORK': 3,
+    '@PARSING': 4
+}
+
+LAST_IN_SEQUENCE = ('18446744073709551615', '4294967295')  # ULONG_MAX
+
+
+def abs_path(rel_path):
+    return os.path.join(
+        os.path.dirname(os.path.dirname(os.path.realpath(__file__))),
+        rel_path
+    )
+
+
+class Policy(object):
+    """
+    Mirrors SpecificationPolicy::load and SpecificationPolicy::queueFor of the record client.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.queues = []  # (name, finish sequences, match all, types, categories) in file order
+        order = []
+
+        with open(path, 'r') as fp:
+            for line in fp:
+                tokens = line.split('#', 1)[0].split()
+
+                if len(tokens) == 0:
+                    continue
+
+                if tokens[0] == 'queue':
+                    name = tokens[1]
+                    matches = tokens[2:]
+
+                    finish_sequences = len(matches) > 0 and matches[0] == 'finish-sequences'
+                    if finish_sequences:
+                        matches = matches[1:]
+
+                    self.queues.append((
+                        name,
+                        finish_sequences,
+                        '*' in matches,
+                        set(match for match in matches if match != '*' and not match.startswith('@')),
+                        set(CATEGORIES[match] for match in matches if match.startswith('@'))
+                    ))
+
+                elif tokens[0] == 'order':
+                    order = tokens[1:]
+
+        if len(order) == 0:
+            order = [queue[0] for queue in self.queues]
+
+        self.priority = dict((name, index) for index, name in enumerate(order))
+
+    def queue_for(self, descriptor):
+        category, kind = descriptor_kind(descriptor)
+
+        for name, finish_sequences, match_all, types, categories in self.queues:
+            if match_all or kind in types or category in categories:
+                return name
+
+        return min(self.priority, key=self.priority.get)
+
+    def finishes_sequences(self, name):
+        return any(queue[1] for queue in self.queues if queue[0] == name)
+
+
+def descriptor_kind(descriptor):
+    """
+    <category>-<type>(<params>) -> (category, type)
+    """
+
+    category, rest = descriptor.split('-', 1)
+    return int(category), rest.split('(', 1)[0]
+
+
+def descriptor_params(descriptor):
+    return descriptor.split('(', 1)[1][:-1].split(',')
+
+
+def network_sequence(descriptor):
+    """
+    url,url-sequence-number of network event actions, as SpecificationScheduler::getNetworkSequenceId
+    """
+
+    if descriptor_kind(descriptor)[1] != 'Network':
+        return None
+
+    params = descriptor_params(descriptor)
+    return '%s,%s' % (params[0], params[1])
+
+
+def read_trace(path):
+    """
+    Returns (descriptor, event actions pending when it was picked) of each executed event action, in execution order.
+    See SpecificationScheduler::openTrace for the format.
+    """
+
+    pending = Counter()
+    picked = None
+    decisions = []
+
+    with open(path, 'r') as fp:
+        for line in fp:
+            line = line.rstrip('\n')
+
+            if ';' not in line:
+                continue
+
+            decision, descriptor = line.split(';', 1)
+
+            if decision == 'scheduled':
+                pending[descriptor] += 1
+
+            elif decision == 'descheduled':
+                del pending[descriptor]
+
+            elif decision == 'picked':
+                picked = Counter(pending)
+
+            elif decision == 'executed':
+                decisions.append((descriptor, picked))
+
+                pending[descriptor] -= 1
+                if pending[descriptor] <= 0:
+                    del pending[descriptor]
+
+    return decisions
+
+
+def check(policy, decisions):
+    """
+    Returns a list of violations of the policy in the decisions of the scheduler
+    """
+
+    violations = []
+    active = None  # started network request of a finish-sequences queue
+
+    for index, (descriptor, pending) in enumerate(decisions):
+
+        pending = Counter(pending)
+        pending[descriptor] -= 1
+
+        sequence = network_sequence(descriptor)
+
+        if active is not None and sequence != active:
+            if any(count > 0 and network_sequence(other) == active for other, count in pending.items()):
+                violations.append('%d: %s ran while network request %s was unfinished' % (index, descriptor, active))
+
+            active = None
+
+        if active is not None:
+            # continuation of the started request, runs before anything else
+            if descriptor_params(descriptor)[2] in LAST_IN_SEQUENCE:
+                active = None
+
+            continue
+
+        queue = policy.queue_for(descriptor)
+
+        for other, count in pending.items():
+            if count <= 0:
+                continue
+
+            other_queue = policy.queue_for(other)
+
+            if policy.priority[other_queue] < policy.priority[queue]:
+                violations.append('%d: %s (%s) ran while %s (%s) was pending' % (index, descriptor, queue, other, other_queue))
+
+        if sequence is not None and policy.finishes_sequences(queue) and \
+           descriptor_params(descriptor)[2] not in LAST_IN_SEQUENCE:
+            active = sequence
+
+    return violations
+
+
+def record(policy_path, page, out_dir, trace_path, verbose):
+    record_cmd = [abs_path('clients/Record/bin/record'), '-autoexplore', '-autoexplore-timeout', '5', '-hidewindow',
+                  '-specification-policy', policy_path, '-specification-trace', trace_path, '-out_dir', out_dir,
+                  'file://%s' % page]
+
+    if verbose:
+        print(' recording... (%s)' % ' '.join(record_cmd))
+
+    subprocess.check_output(record_cmd, stderr=subprocess.STDOUT)
+
+
+if __name__ == '__main__':
+
+    verbose = False
+    if '--verbose' in sys.argv:
+        verbose = True
+        sys.argv.remove('--verbose')
+
+    policy_dir = abs_path('clients/Record/policies')
+    policies = [os.path.join(policy_dir, name) for name in sorted(os.listdir(policy_dir)) if name.endswith('.policy')]
+
+    if '--policy' in sys.argv:
+        index = sys.argv.index('--policy')
+        policies = [os.path.abspath(sys.argv[index + 1])]
+        del sys.argv[index:index + 2]
+
+    if len(sys.argv) > 1:
+        pages = [os.path.abspath(page) for page in sys.argv[1:]]
+    else:
+        example_dir = abs_path('examples')
+        pages = [os.path.join(example_dir, name) for name in sorted(os.listdir(example_dir)) if name.endswith('.html')]
+
+    failed = 0
+
+    for policy_path in policies:
+        policy = Policy(policy_path)
+
+        for page in pages:
+            print('Testing %s with %s' % (os.path.basename(page), os.path.basename(policy_path)))
+
+            out_dir = tempfile.mkdtemp(prefix='r4-check-policies-')
+
+            try:
+                trace_path = os.path.join(out_dir, 'specification.trace')
+                record(policy_path, page, out_dir, trace_path, verbose)
+                violations = check(policy, read_trace(trace_path))
+            except subprocess.CalledProcessError as e:
+                violations = ['record failed: %s' % e]
+
+            shutil.rmtree(out_dir)
+
+            if len(violations) == 0:
+                print(' OK')
+            else:
+                failed += 1
+                print(' FAILED')
+                for violation in violations:
+                    print('  %s' % violation)
+
+    print('')
+    print('%d of %d recordings violate their policy' % (failed, len(policies) * len(pages)))
+
+    sys.exit(1 if failed > 0 else 0)
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+
+"""
+List and extract replay output containers written with replay -out_pack <container>.
+
+A container is a sequence of entries (big endian): MAGIC, VERSION, name size (uint32), name (UTF-8), data size
+(uint64), data. A later entry replaces an earlier entry with the same name, and a truncated last entry is ignored.
+
+Usage: r4pack.py list <container>
+       r4pack.py extract <container> <out_dir> [<prefix>]
+"""
+
+import os
+import struct
+import sys
+
+MAGIC = 0x52345045
+VERSION = 1
+
+HEADER = struct.Struct('>III')
+SIZE = struct.Struct('>Q')
+
+
+def table_of_contents(path):
+    """
+    Returns the latest (name, offset, size) of each entry, in container order.
+    """
+
+    entries = {}
+    order = []
+
+    with open(path, 'rb') as fp:
+        fp.seek(0, 2)
+        end = fp.tell()
+        fp.seek(0)
+
+        while True:
+            header = fp.read(HEADER.size)
+            if len(header) != HEADER.size:
+                break
+
+            magic, version, name_size = HEADER.unpack(header)
+            if magic != MAGIC or version != VERSION:
+                break
+
+            name = fp.read(name_size)
+            size = fp.read(SIZE.size)
+            if len(name) != name_size or len(size) != SIZE.size:
+                break
+
+            size, = SIZE.unpack(size)
+            offset = fp.tell()
+
+            if offset + size > end:
+                break  # truncated entry
+
+            name = name.decode('utf-8')
+            if name not in entries:
+                order.append(name)
+
+            entries[name] = (offset, size)
+            fp.seek(offset + size)
+
+    return [(name, entries[name][0], entries[name][1]) for name in order]
+
+
+def extract(path, out_dir, prefix=''):
+    entry_prefix = prefix + '/' if prefix else ''
+    extracted = 0
+
+    with open(path, 'rb') as fp:
+        for name, offset, size in table_of_contents(path):
+            if not name.startswith(entry_prefix):
+                continue
+
+            relative = os.path.normpath(name[len(entry_prefix):])
+            if relative.startswith('..') or os.path.isabs(relative):
+                continue
+
+            target = os.path.join(out_dir, relative)
+
+            os.makedirs(os.path.dirname(target) or '.', exist_ok=True)
+
+            fp.seek(offset)
+            with open(target, 'wb') as out:
+                out.write(fp.read(size))
+
+            extracted += 1
+
+    return extracted
+
+
+if __name__ == '__main__':
+
+    if len(sys.argv) == 3 and sys.argv[1] == 'list':
+        for name, offset, size in table_of_contents(sys.argv[2]):
+            print('%10d %s' % (size, name))
+
+    elif len(sys.argv) in (4, 5) and sys.argv[1] == 'extract':
+        prefix = sys.argv[4] if len(sys.argv) == 5 else ''
+        print('Extracted %d entries' % extract(sys.argv[2], sys.argv[3], prefix))
+
+    else:
+        print('Usage: %s list <container>' % sys.argv[0])
+        print('       %s extract <container> <out_dir> [<prefix>]' % sys.argv[0])
+        sys.exit(1)
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+
+"""
+Slice a recorded schedule down to the event actions needed to reproduce a race.
+
+The slice contains the race pair A and B, the event actions writing a memory location accessed by A or B, and all
+happens-before ancestors of these (read from the ER_actionlog of the recording). All other event actions are written
+to the relaxable file, which replay takes as -relaxable <file> such that it does not wait for them. With --drop they
+are removed from the schedule instead.
+
+Usage: slice-schedule.py [--drop] ER_actionlog schedule.data <A> <B> out.schedule.data out.relaxable
+"""
+
+import struct
+import sys
+
+READ_MEMORY = 2
+WRITE_MEMORY = 3
+TRIGGER_ARC = 4
+
+
+def read_ints(fp, count):
+    data = fp.read(4 * count)
+    if len(data) != 4 * count:
+        raise IOError('Unexpected end of action log')
+    return struct.unpack('<%di' % count, data)
+
+
+def skip_string_set(fp):
+    # StringSet::saveToFile, <size> <data> <number of hashes>
+    size, = read_ints(fp, 1)
+    fp.seek(size, 1)
+    read_ints(fp, 1)
+
+
+def read_action_log(path):
+    """
+    Returns the happens-before predecessors and the read and written memory locations of each event action, as saved
+    by ActionLogSave (variable set, scope set, action log, ...).
+    """
+
+    predecessors = {}
+    reads = {}
+    writes = {}
+
+    with open(path, 'rb') as fp:
+        skip_string_set(fp)
+        skip_string_set(fp)
+
+        num_ops, num_arcs = read_ints(fp, 2)
+
+        for _ in range(num_arcs):
+            tail, head, _duration = read_ints(fp, 3)
+            predecessors.setdefault(head, set()).add(tail)
+
+        for _ in range(num_ops):
+            op_id, _op_type, num_commands = read_ints(fp, 3)
+            commands = read_ints(fp, 2 * num_commands)
+
+            op_reads = reads.setdefault(op_id, set())
+            op_writes = writes.setdefault(op_id, set())
+
+            for i in range(0, len(commands), 2):
+                cmd_type, location = commands[i], commands[i + 1]
+
+                if cmd_type == READ_MEMORY:
+                    op_reads.add(location)
+                elif cmd_type == WRITE_MEMORY:
+                    op_writes.add(location)
+                elif cmd_type == TRIGGER_ARC and location >= 0:
+                    predecessors.setdefault(location, set()).add(op_id)
+
+    return predecessors, reads, writes
+
+
+def read_schedule(path):
+    """
+    Returns the schedule as (event action id or None, line) tuples, None for <relax> and <change> tokens.
+    """
+
+    schedule = []
+
+    with open(path, 'r') as fp:
+        for line in fp:
+            line = line.rstrip('\n')
+
+            if line == '':
+                continue
+
+            if line in ('<relax>', '<change>'):
+                schedule.append((None, line))
+            else:
+                schedule.append((int(line.split(';', 1)[0]), line))
+
+    return schedule
+
+
+def slice_event_actions(race, predecessors, reads, writes):
+    accessed = set()
+    for op_id in race:
+        accessed |= reads.get(op_id, set())
+        accessed |= writes.get(op_id, set())
+
+    roots = set(race)
+    for op_id, locations in writes.items():
+        if locations & accessed:
+            roots.add(op_id)
+
+    # Happens-before ancestors of all roots
+    needed = set()
+    worklist = list(roots)
+
+    while worklist:
+        op_id = worklist.pop()
+
+        if op_id in needed:
+            continue
+
+        needed.add(op_id)
+        worklist.extend(predecessors.get(op_id, ()))
+
+    return needed
+
+
+if __name__ == '__main__':
+
+    drop = False
+    if '--drop' in sys.argv:
+        drop = True
+        sys.argv.remove('--drop')
+
+    if len(sys.argv) != 7:
+        print('Usage: %s [--drop] ER_actionlog schedule.data <A> <B> out.schedule.data out.relaxable' % sys.argv[0])
+        sys.exit(1)
+
+    predecessors, reads, writes = read_action_log(sys.argv[1])
+    schedule = read_schedule(sys.argv[2])
+    race = (int(sys.argv[3]), int(sys.argv[4]))
+
+    needed = slice_event_actions(race, predecessors, reads, writes)
+
+    kept = 0
+    relaxable = []
+
+    with open(sys.argv[5], 'w') as out:
+        for op_id, line in schedule:
+
+            # Tokens, and event actions unknown to the action log, are kept as they are
+            if op_id is not None and op_id in reads and op_id not in needed:
+                relaxable.append(op_id)
+
+                if drop:
+                    continue
+            else:
+                kept += 1
+
+            out.write(line + '\n')
+
+    with open(sys.argv[6], 'w') as out:
+        for op_id in relaxable:
+            out.write('%d\n' % op_id)
+
+    print('Kept %d of %d schedule entries, %d relaxable' % (kept, len(schedule), len(relaxable)))
@@ -57,6 +57,13 @@ public:
     {
     }
 
+    // Restart the sequence, as WeakRandom seeded with seed
+    void setSeed(unsigned seed)
+    {
+        m_low = seed ^ 0x49616E42;
+        m_high = 0;
+    }
+
     virtual double get()
     {
         return advance() / (UINT_MAX + 1.0);
@@ -113,6 +113,7 @@ HEADERS += \
     RefPtrHashMap.h \
     RetainPtr.h \
     SHA1.h \
+    SHA256.h \
     Spectrum.h \
     StackBounds.h \
     StaticConstructors.h \
@@ -206,6 +207,7 @@ SOURCES += \
     RandomNumber.cpp \
     RefCountedLeakCounter.cpp \
     SHA1.cpp \
+    SHA256.cpp \
     StackBounds.cpp \
     TCSystemAlloc.cpp \
     Threading.cpp \
@@ -8,6 +8,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "Assertions.h"
 #include "ActionLogReport.h"
 #include "WTFThreadData.h"
@@ -15,6 +16,14 @@
 
 #include <set>
 #include <queue>
+#include <list>
+#include <map>
+#include <vector>
+#include <string.h>
+
+#include <wtf/HashMap.h>
+#include <wtf/StringHasher.h>
+#include <wtf/Vector.h>
 
 ActionLogScope::ActionLogScope(const char* name) {
 	ActionLogScopeStart(name);
@@ -53,6 +62,47 @@ void ActionLogScopeEnd() {
     }
 }
 
+static bool track_memory_values = false;
+static int pending_write = -1;  // Location of the last write, until its value is reported.
+static unsigned pending_write_hash = 0;
+static std::map<int, unsigned> memory_values;  // Location -> hash of the location and its last written value.
+static unsigned memory_fingerprint = 0;  // Sum of memory_values.
+
+static unsigned memoryStringHash(const char* s) {
+	return WTF::StringHasher::computeHash(reinterpret_cast<const LChar*>(s), strlen(s));
+}
+
+// Hashes strings rather than string ids, ids depend on the order in which locations were first seen.
+static void trackMemoryCommand(ActionLog::CommandType cmd, int stringId, const char* str) {
+	if (cmd == ActionLog::WRITE_MEMORY) {
+		pending_write = stringId;
+		pending_write_hash = memoryStringHash(str);
+		return;
+	}
+
+	if (cmd == ActionLog::MEMORY_VALUE && pending_write != -1) {
+		unsigned entry = pending_write_hash * 31 + memoryStringHash(str);
+
+		std::pair<std::map<int, unsigned>::iterator, bool> result = memory_values.insert(std::make_pair(pending_write, entry));
+		if (!result.second) {
+			memory_fingerprint -= result.first->second;
+			result.first->second = entry;
+		}
+		memory_fingerprint += entry;
+	}
+
+	pending_write = -1;
+}
+
+void ActionLogTrackMemoryValues(bool track) {
+	track_memory_values = track;
+	pending_write = -1;
+}
+
+unsigned ActionLogMemoryFingerprint() {
+	return memory_fingerprint;
+}
+
 void ActionLogFormatV(ActionLog::CommandType cmd, const char* format, va_list ap) {
     char strspace[512] = { 0 };
     vsnprintf(strspace, sizeof(strspace) - 1, format, ap);
@@ -67,6 +117,9 @@ void ActionLogFormatV(ActionLog::CommandType cmd, const char* format, va_list ap
     } else {
         stringId = wtfThreadData().variableSet()->addString(strspace);
     }
+    if (track_memory_values) {
+        trackMemoryCommand(cmd, stringId, strspace);
+    }
     if (!wtfThreadData().actionLog()->logCommand(cmd, stringId)) {
         fprintf(stderr, "Can't log command %s %s\n", ActionLog::CommandType_AsString(cmd), strspace);
         if (strict_mode) {
@@ -110,6 +163,9 @@ void ActionLogReportArrayModify(size_t array) {
 
 void ActionLogReportMemoryValue(const char* value) {
     int stringId = wtfThreadData().dataSet()->addString(value);
+    if (track_memory_values) {
+        trackMemoryCommand(ActionLog::MEMORY_VALUE, stringId, value);
+    }
     if (!wtfThreadData().actionLog()->logCommand(ActionLog::MEMORY_VALUE, stringId) && strict_mode) {
         fprintf(stderr, "Can't log value %s\n", value);
         CRASH();
@@ -168,6 +224,10 @@ int ActionLogRegisterSource(const char* src) {
 }
 
 bool ActionLogWillAddCommand(ActionLog::CommandType cmd) {
+	// The value of a tracked write is reported even if the log skips it, logCommand then drops it.
+	if (cmd == ActionLog::MEMORY_VALUE && track_memory_values && pending_write != -1) {
+		return true;
+	}
 	return wtfThreadData().actionLog()->willLogCommand(cmd);
 }
 
@@ -181,6 +241,27 @@ void ActionLogSave(const std::string& path) {
 	fclose(f);
 }
 
+bool ActionLogSerialize(std::string* data) {
+    char* buffer = 0;
+    size_t size = 0;
+
+    FILE* f = open_memstream(&buffer, &size);
+    if (f == NULL) {
+        return false;
+    }
+
+	wtfThreadData().variableSet()->saveToFile(f);
+	wtfThreadData().scopeSet()->saveToFile(f);
+	wtfThreadData().actionLog()->saveToFile(f);
+	wtfThreadData().jsSet()->saveToFile(f);
+	wtfThreadData().dataSet()->saveToFile(f);
+	fclose(f);
+
+    data->assign(buffer, size);
+    free(buffer);
+    return true;
+}
+
 const std::vector<ActionLog::Arc>& ActionLogReportArcs() {
     return wtfThreadData().actionLog()->arcs();
 }
@@ -245,59 +326,293 @@ EventAttachLog::EventType EventAttachLog::StrEventType(const char* str) {
     return EV_NUM_EVENTS; // unknown/unsupported event
 }
 
-void EventAttachLog::addEventStr(void* eventTarget, const char* str) {
+bool EventAttachLog::isExplorable(const char* str) {
 
     EventAttachLog::EventType type = EventAttachLog::StrEventType(str);
 
     if (type == EV_CLICK) {
         // Note(veselin): Currently we will not auto-trigger event when a click handler is attached.
-        return;
+        return false;
     }
 
     if (type == EV_NUM_EVENTS) {
         // Unknown event
+        return false;
+    }
+
+    return true;
+}
+
+const char* EventAttachLog::PolicyStr(Policy policy) {
+	switch (policy) {
+	case POLICY_FIFO: return "fifo";
+	case POLICY_NOVELTY: return "novelty";
+	}
+	return "";
+}
+
+bool EventAttachLog::StrPolicy(const char* str, Policy* policy) {
+
+    if (strcmp(str, "fifo") == 0) {
+        *policy = POLICY_FIFO;
+        return true;
+    } else if (strcmp(str, "novelty") == 0) {
+        *policy = POLICY_NOVELTY;
+        return true;
+    }
+
+    return false;
+}
+
+void EventAttachLog::addEventStr(void* eventTarget, const char* str, const std::string& handler, const std::string& signature) {
+
+    if (!isExplorable(str)) {
         return;
     }
 
-    addEvent(eventTarget, type);
+    addEvent(eventTarget, EventAttachLog::StrEventType(str), handler, signature);
 }
 
+// Events are grouped by type, handler and target signature. Each group keeps its events in a FIFO list, and each target
+// maps to the handles (list positions) of its events. Thus targets are removed in time proportional to their own events,
+// which matters as every destroyed node is removed. Only groups with pending events are active, such that pulling an
+// event only scans those; empty groups are kept (inactive) for their explored count.
+//
+// The default policy is FIFO per type, as before groups were introduced. The novelty policy prefers groups which have been explored less, with handlers and target signatures which have been
+// explored less, such that e.g. hundreds of list items sharing a mouseover handler do not use up the exploration budget.
 class EventAttachLogImpl : public EventAttachLog {
 public:
-	EventAttachLogImpl() {}
-	virtual ~EventAttachLogImpl() {}
+	EventAttachLogImpl()
+		: m_policy(POLICY_FIFO)
+		, m_sequenceNumber(0) {
+		memset(m_counters, 0, sizeof(m_counters));
+	}
 
-    virtual void removeEventTarget(void* eventTarget) {
+	virtual ~EventAttachLogImpl() {
 		for (int i = 0; i < EV_NUM_EVENTS; ++i) {
-			int l = m_queues[i].size();
-			for (int j = 0; j < l; ++j) {
-				if (m_queues[i].empty()) break;
-				if (m_queues[i].front() != eventTarget) {
-					m_queues[i].push_back(m_queues[i].front());
-				}
-				m_queues[i].pop_front();
+			std::map<std::string, Group*>::iterator iter = m_groupIndex[i].begin();
+			for (; iter != m_groupIndex[i].end(); ++iter) {
+				delete iter->second;
 			}
 		}
 	}
 
-    virtual void addEvent(void* eventTarget, EventType eventType) {
-		m_queues[eventType].push_back(eventTarget);
+    virtual void removeEventTarget(void* eventTarget) {
+		TargetMap::iterator target = m_targets.find(eventTarget);
+		if (target == m_targets.end()) {
+			return;
+		}
+
+		const Handles& handles = target->second;
+		for (size_t i = 0; i < handles.size(); ++i) {
+			Group* group = handles[i].first;
+			group->queue.erase(handles[i].second);
+			m_counters[group->type].removed++;
+			m_counters[group->type].pending--;
+
+			if (group->queue.empty()) {
+				deactivate(group);
+			}
+		}
+
+		m_targets.remove(target);
+	}
+
+    virtual void addEvent(void* eventTarget, EventType eventType, const std::string& handler, const std::string& signature) {
+		Group* group = findOrCreateGroup(eventType, handler, signature);
+
+		if (group->queue.empty()) {
+			group->activeHandle = m_activeGroups[eventType].insert(m_activeGroups[eventType].end(), group);
+		}
+
+		Queue::iterator handle = group->queue.insert(group->queue.end(), std::make_pair(eventTarget, m_sequenceNumber++));
+		m_counters[eventType].added++;
+		m_counters[eventType].pending++;
+
+		TargetMap::AddResult target = m_targets.add(eventTarget, Handles());
+		target.iterator->second.append(std::make_pair(group, handle));
 	}
 
     virtual bool pullEvent(void** eventTarget, EventType* eventType) {
+		Group* best = m_policy == POLICY_FIFO ? oldestGroup() : mostNovelGroup();
+
+		if (best == NULL) {
+			return false;
+		}
+
+		*eventType = best->type;
+		*eventTarget = best->queue.front().first;
+
+		forgetHandle(best->queue.front().first, best, best->queue.begin());
+		best->queue.pop_front();
+
+		if (best->queue.empty()) {
+			deactivate(best);
+		}
+
+		best->explored++;
+		m_exploredHandlers[best->handler]++;
+		m_exploredSignatures[best->signature]++;
+
+		m_counters[best->type].pulled++;
+		m_counters[best->type].pending--;
+
+		return true;
+	}
+
+    virtual Counters counters(EventType eventType) const {
+		return m_counters[eventType];
+	}
+
+    virtual void setPolicy(Policy policy) {
+		m_policy = policy;
+	}
+
+    virtual std::string policyDescription() const {
+		char description[128];
+
+		if (m_policy == POLICY_NOVELTY) {
+			snprintf(description, sizeof(description), "%s group=%d handler=%d signature=%d",
+			         PolicyStr(m_policy), WEIGHT_GROUP, WEIGHT_HANDLER, WEIGHT_SIGNATURE);
+		} else {
+			snprintf(description, sizeof(description), "%s", PolicyStr(m_policy));
+		}
+
+		return description;
+	}
+
+private:
+	enum {
+		WEIGHT_GROUP = 1,
+		WEIGHT_HANDLER = 4,
+		WEIGHT_SIGNATURE = 2
+	};
+
+	typedef std::list<std::pair<void*, unsigned> > Queue; // target, sequence number
+
+	struct Group;
+	typedef std::list<Group*> GroupList;
+
+	struct Group {
+		EventType type;
+		std::string handler;
+		std::string signature;
+		Queue queue;
+		unsigned explored;
+		GroupList::iterator activeHandle; // position in m_activeGroups, valid while queue is not empty
+	};
+
+	typedef Vector<std::pair<Group*, Queue::iterator> > Handles;
+	typedef HashMap<void*, Handles> TargetMap;
+
+	Group* findOrCreateGroup(EventType eventType, const std::string& handler, const std::string& signature) {
+		std::string key = handler + '\n' + signature;
+
+		std::map<std::string, Group*>::iterator iter = m_groupIndex[eventType].find(key);
+		if (iter != m_groupIndex[eventType].end()) {
+			return iter->second;
+		}
+
+		Group* group = new Group();
+		group->type = eventType;
+		group->handler = handler;
+		group->signature = signature;
+		group->explored = 0;
+
+		m_groupIndex[eventType][key] = group;
+
+		return group;
+	}
+
+	void deactivate(Group* group) {
+		m_activeGroups[group->type].erase(group->activeHandle);
+	}
+
+	// Same order as a FIFO per type
+	Group* oldestGroup() const {
 		for (int i = 0; i < EV_NUM_EVENTS; ++i) {
-			if (!m_queues[i].empty()) {
-                *eventType = static_cast<EventType>(i);
-				*eventTarget = m_queues[i].front();
-                m_queues[i].pop_front();
-				return true;
+			Group* oldest = NULL;
+
+			for (GroupList::const_iterator iter = m_activeGroups[i].begin(); iter != m_activeGroups[i].end(); ++iter) {
+				Group* group = *iter;
+				if (oldest == NULL || group->queue.front().second < oldest->queue.front().second) {
+					oldest = group;
+				}
+			}
+
+			if (oldest != NULL) {
+				return oldest;
 			}
 		}
-		return false;
+
+		return NULL;
 	}
 
-private:
-    std::deque<void*> m_queues[EV_NUM_EVENTS];
+	// Ties are broken by type, and then by the order in which groups became active
+	Group* mostNovelGroup() const {
+		Group* best = NULL;
+		double bestScore = 0;
+
+		for (int i = 0; i < EV_NUM_EVENTS; ++i) {
+			for (GroupList::const_iterator iter = m_activeGroups[i].begin(); iter != m_activeGroups[i].end(); ++iter) {
+				Group* group = *iter;
+				double score = noveltyScore(group);
+				if (best == NULL || score > bestScore) {
+					best = group;
+					bestScore = score;
+				}
+			}
+		}
+
+		return best;
+	}
+
+	double noveltyScore(const Group* group) const {
+		double score = WEIGHT_GROUP / (1.0 + group->explored);
+
+		// Handlers are unknown for e.g. lazy attribute handlers, they do not count as novel
+		if (!group->handler.empty()) {
+			score += WEIGHT_HANDLER / (1.0 + exploredCount(m_exploredHandlers, group->handler));
+		}
+
+		score += WEIGHT_SIGNATURE / (1.0 + exploredCount(m_exploredSignatures, group->signature));
+
+		return score;
+	}
+
+	static unsigned exploredCount(const std::map<std::string, unsigned>& explored, const std::string& key) {
+		std::map<std::string, unsigned>::const_iterator iter = explored.find(key);
+		return iter == explored.end() ? 0 : iter->second;
+	}
+
+	void forgetHandle(void* eventTarget, Group* group, Queue::iterator handle) {
+		TargetMap::iterator target = m_targets.find(eventTarget);
+		ASSERT(target != m_targets.end());
+
+		Handles& handles = target->second;
+		for (size_t i = 0; i < handles.size(); ++i) {
+			if (handles[i].first == group && handles[i].second == handle) {
+				handles.remove(i);
+				break;
+			}
+		}
+
+		if (handles.isEmpty()) {
+			m_targets.remove(target);
+		}
+	}
+
+    Policy m_policy;
+    unsigned m_sequenceNumber;
+
+    GroupList m_activeGroups[EV_NUM_EVENTS]; // groups with pending events, in the order they became active
+    std::map<std::string, Group*> m_groupIndex[EV_NUM_EVENTS]; // all groups, owned
+
+    std::map<std::string, unsigned> m_exploredHandlers;
+    std::map<std::string, unsigned> m_exploredSignatures;
+
+    TargetMap m_targets;
+    Counters m_counters[EV_NUM_EVENTS];
 };
 
 EventAttachLog* getEventAttachLog() {
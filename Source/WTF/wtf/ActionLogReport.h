@@ -36,6 +36,12 @@ void ActionLogReportArrayModify(size_t array);  // Writes to more than one array
 void ActionLogFormat(ActionLog::CommandType cmd, const char* format, ...);
 bool ActionLogWillAddCommand(ActionLog::CommandType cmd);
 
+// Tracks the last value written to each memory location (off by default). Values are tracked even if the log skips
+// them, e.g. for repeated writes to a location within the same event action.
+void ActionLogTrackMemoryValues(bool track);
+// Order independent hash of the (location, last written value) pairs, a fingerprint of the JavaScript state.
+unsigned ActionLogMemoryFingerprint();
+
 void ActionLogEnterOperation(int id, ActionLog::EventActionType type);
 void ActionLogExitOperation();
 
@@ -43,6 +49,8 @@ int ActionLogScopeDepth();
 
 void ActionLogAddArc(int earlierId, int laterId, int duration);
 void ActionLogSave(const std::string& path);
+// The contents ActionLogSave writes, serialized into memory such that callers can write them off the main thread.
+bool ActionLogSerialize(std::string* data);
 
 const std::vector<ActionLog::Arc>& ActionLogReportArcs();
 
@@ -80,11 +88,39 @@ public:
 	static const char* EventTypeStr(EventType t);
     static EventAttachLog::EventType StrEventType(const char* t);
 
-    void addEventStr(void* eventTarget, const char* str);
+    // Events of this type are explored (click handlers and unknown events are not)
+    static bool isExplorable(const char* str);
+
+    // Order in which pullEvent hands out events
+    enum Policy {
+        POLICY_FIFO = 0,   // by type, then in the order the events were attached (default)
+        POLICY_NOVELTY     // highest novelty first, see EventAttachLogImpl::noveltyScore
+    };
+
+    static const char* PolicyStr(Policy policy);
+    static bool StrPolicy(const char* str, Policy* policy);
+
+    // handler identifies the handler function, signature the target (e.g. tag and class), both may be empty
+    void addEventStr(void* eventTarget, const char* str, const std::string& handler = std::string(), const std::string& signature = std::string());
 
     virtual void removeEventTarget(void* eventTarget) = 0;
-    virtual void addEvent(void* eventTarget, EventType eventType) = 0;
+    virtual void addEvent(void* eventTarget, EventType eventType, const std::string& handler = std::string(), const std::string& signature = std::string()) = 0;
     virtual bool pullEvent(void** eventTarget, EventType* eventType) = 0;
+
+    virtual void setPolicy(Policy policy) = 0;
+
+    // Policy and its parameters, recorded such that an exploration can be reproduced
+    virtual std::string policyDescription() const = 0;
+
+    // Exploration progress per event type
+    struct Counters {
+        unsigned added;   // events attached
+        unsigned pulled;  // events handed out for exploration
+        unsigned removed; // events dropped because the target was removed
+        unsigned pending; // events waiting to be pulled
+    };
+
+    virtual Counters counters(EventType eventType) const = 0;
 };
 
 EventAttachLog* getEventAttachLog();
@@ -27,14 +27,105 @@
 #include <fstream>
 #include <cstdlib>
 #include <assert.h>
-#include <malloc.h>
+#include <map>
 #include <sstream>
 
 namespace WTF {
 
+namespace {
+
+struct KindInfo {
+    std::string module;
+    std::string shortDescription;
+    unsigned maxExemplars;
+    size_t maxDetails;
+};
+
+// Kinds are shared by all collectors, and only registered from the main thread
+std::vector<KindInfo>& kinds()
+{
+    static std::vector<KindInfo> kinds;
+    return kinds;
+}
+
+std::map<std::pair<std::string, std::string>, WarningKind>& kindIndex()
+{
+    static std::map<std::pair<std::string, std::string>, WarningKind> index;
+    return index;
+}
+
+bool isPowerOfTwo(unsigned value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+}
+
+WarningKind WarningCollector::registerKind(const std::string& module, const std::string& shortDescription, unsigned maxExemplars, size_t maxDetails)
+{
+    std::pair<std::string, std::string> key(module, shortDescription);
+
+    std::map<std::pair<std::string, std::string>, WarningKind>::iterator iter = kindIndex().find(key);
+    if (iter != kindIndex().end()) {
+        return iter->second;
+    }
+
+    KindInfo info;
+    info.module = module;
+    info.shortDescription = shortDescription;
+    info.maxExemplars = maxExemplars;
+    info.maxDetails = maxDetails;
+
+    WarningKind kind = kinds().size();
+    kinds().push_back(info);
+    kindIndex()[key] = kind;
+
+    return kind;
+}
+
+bool WarningCollector::wantsDetails(WarningKind kind) const
+{
+    assert(kind < kinds().size());
+
+    unsigned count = kind < m_counts.size() ? m_counts[kind] : 0;
+
+    // Keep the first exemplars, and then every 2^n-th warning such that late warnings are not lost entirely
+    return count < kinds()[kind].maxExemplars || isPowerOfTwo(count + 1);
+}
+
+void WarningCollector::collect(EventActionId eventActionId, WarningKind kind, const std::string& details)
+{
+    assert(kind < kinds().size());
+
+    if (m_counts.size() <= kind) {
+        m_counts.resize(kinds().size(), 0);
+        m_kept.resize(kinds().size(), 0);
+    }
+
+    bool keep = wantsDetails(kind);
+
+    m_counts[kind]++;
+
+    if (!keep) {
+        return;
+    }
+
+    m_kept[kind]++;
+
+    size_t maxDetails = kinds()[kind].maxDetails;
+
+    if (details.length() <= maxDetails) {
+        m_warnings.push_back(Warning(eventActionId, kind, details));
+    } else {
+        std::stringstream truncated;
+        truncated << details.substr(0, maxDetails) << std::endl << "[truncated " << (details.length() - maxDetails) << " bytes]";
+        m_warnings.push_back(Warning(eventActionId, kind, truncated.str()));
+    }
+}
+
 void WarningCollector::collect(EventActionId eventActionId, const std::string& module, const std::string& shortDescription, const std::string& details)
 {
-    m_warnings.push_back(Warning(eventActionId, module, shortDescription, details));
+    collect(eventActionId, registerKind(module, shortDescription, WarningCollectorDefaultExemplars, WarningCollectorDefaultMaxDetails), details);
 }
 
 void WarningCollector::writeLogFile(const std::string& filepath)
@@ -47,15 +138,29 @@ void WarningCollector::writeLogFile(const std::string& filepath)
     std::list<Warning>::iterator iter;
     for (iter = m_warnings.begin(); iter != m_warnings.end(); iter++) {
 
-        std::string details = ((*iter).details);
+        const KindInfo& info = kinds()[(*iter).kind];
+        const std::string& details = (*iter).details;
 
-        fp << (int)(*iter).eventActionId << ";" << (*iter).module << ";" << (*iter).shortDescription << ";" << (details.length() == 0 ? 0 : details.length() + 1) << std::endl;
+        fp << (int)(*iter).eventActionId << ";" << info.module << ";" << info.shortDescription << ";" << (details.length() == 0 ? 0 : details.length() + 1) << std::endl;
 
         if (details.length() != 0) {
             fp << details << std::endl;
         }
     }
 
+    for (WarningKind kind = 0; kind < m_counts.size(); ++kind) {
+
+        if (m_counts[kind] == m_kept[kind]) {
+            continue;
+        }
+
+        std::stringstream details;
+        details << (m_counts[kind] - m_kept[kind]) << ";" << kinds()[kind].module << ";" << kinds()[kind].shortDescription;
+
+        fp << 0 << ";WEBERA_WARNINGS;Suppressed warnings.;" << details.str().length() + 1 << std::endl;
+        fp << details.str() << std::endl;
+    }
+
     fp.close();
 }
 
@@ -95,22 +200,26 @@ WarningCollector WarningCollector::readLogFile(const std::string& filepath)
         std::string detailsLength;
         std::getline(warning, detailsLength);
 
-        // If we have details on the next line, then include those
+        // If we have details on the next line, then include those (without the trailing newline)
 
         int length = atoi(detailsLength.c_str());
 
-        if (length == 0) {
-            collector.m_warnings.push_back(Warning((EventActionId)atoi(eventActionId.c_str()), module, shortDescription, ""));
+        std::string details;
 
-        } else {
-            char* details = new char [length];
-            fp.read(details, length);
+        if (length != 0) {
+            details.resize(length);
+            fp.read(&details[0], length);
+            details.resize(fp.gcount());
 
-            collector.m_warnings.push_back(Warning((EventActionId)atoi(eventActionId.c_str()), module, shortDescription, details));
-
-            delete details;
+            if (!details.empty() && details[details.length() - 1] == '\n') {
+                details.resize(details.length() - 1);
+            }
         }
 
+        // Warnings in the log already passed the exemplar limits, keep all of them
+
+        WarningKind kind = registerKind(module, shortDescription, WarningCollectorDefaultExemplars, WarningCollectorDefaultMaxDetails);
+        collector.m_warnings.push_back(Warning((EventActionId)atoi(eventActionId.c_str()), kind, details));
     }
 
     fp.close();
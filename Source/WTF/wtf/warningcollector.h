@@ -27,36 +27,53 @@
 #include "warningcollectorreport.h"
 
 #include <list>
+#include <vector>
 #include <wtf/EventActionDescriptor.h>
 
 namespace WTF {
 
+/**
+ * Collects the warnings reported while recording or replaying, written to errors.log at exit.
+ *
+ * errors.log is a sequence of entries <event action id>;<module>;<short description>;<details length> followed by
+ * the details if the length is not 0. Warnings dropped by the exemplar limit of their kind are summarized at the end of
+ * the log as WEBERA_WARNINGS "Suppressed warnings." entries with the details <count>;<module>;<short description>.
+ */
 class WarningCollector
 {
 public:
     WarningCollector() {}
+
+    static WarningKind registerKind(const std::string& module, const std::string& shortDescription, unsigned maxExemplars, size_t maxDetails);
+
+    void collect(EventActionId eventActionId, WarningKind kind, const std::string& details);
     void collect(EventActionId eventActionId, const std::string& module, const std::string& shortDescription, const std::string& details);
+
+    // True if the next warning of this kind is kept with its details
+    bool wantsDetails(WarningKind kind) const;
+
     void writeLogFile(const std::string& filepath);
 
     static WarningCollector readLogFile(const std::string& filepath);
 
 private:
     typedef struct warning_t {
-        const EventActionId eventActionId;
-        const std::string module;
-        const std::string shortDescription;
-        const std::string details;
+        EventActionId eventActionId;
+        WarningKind kind;
+        std::string details;
 
-        warning_t(EventActionId eventActionId, const std::string& module, const std::string& shortDescription, const std::string& details)
+        warning_t(EventActionId eventActionId, WarningKind kind, const std::string& details)
             : eventActionId(eventActionId)
-            , module(module)
-            , shortDescription(shortDescription)
+            , kind(kind)
             , details(details)
         {}
 
     } Warning;
 
     std::list<Warning> m_warnings;
+
+    std::vector<unsigned> m_counts; // by kind, including suppressed warnings
+    std::vector<unsigned> m_kept;   // by kind
 };
 
 }
@@ -31,6 +31,21 @@ namespace WTF {
 
 static EventActionId currentEventAction = 0;
 
+WarningKind WarningCollectorRegisterKind(const std::string& module, const std::string& shortDescription, unsigned maxExemplars, size_t maxDetails)
+{
+    return WarningCollector::registerKind(module, shortDescription, maxExemplars, maxDetails);
+}
+
+void WarningCollectorReport(WarningKind kind, const std::string& details)
+{
+    wtfThreadData().warningCollector()->collect(currentEventAction, kind, details);
+}
+
+bool WarningCollectorWantsDetails(WarningKind kind)
+{
+    return wtfThreadData().warningCollector()->wantsDetails(kind);
+}
+
 void WarningCollectorReport(const std::string& module, const std::string& shortDescription, const std::string& details)
 {
     wtfThreadData().warningCollector()->collect(currentEventAction, module, shortDescription, details);
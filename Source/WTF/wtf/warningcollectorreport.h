@@ -29,7 +29,29 @@
 
 namespace WTF {
 
+/**
+ * Warnings are aggregated per kind (module, short description). A kind counts all its warnings, but only keeps the
+ * details of its first maxExemplars warnings (and of every 2^n-th warning after that), thus errors.log stays bounded.
+ *
+ * Frequent warnings should register their kind once and check WarningCollectorWantsDetails before formatting
+ * expensive details.
+ */
+typedef unsigned WarningKind;
+
+static const unsigned WarningCollectorDefaultExemplars = 1000;
+// Kinds compared one by one by the batch reports (console.log, exceptions), which compare the counts of their suppressed
+// warnings beyond this
+static const unsigned WarningCollectorComparedExemplars = 10000;
+static const size_t WarningCollectorDefaultMaxDetails = 64 * 1024;
+
+WarningKind WarningCollectorRegisterKind(const std::string& module, const std::string& shortDescription,
+                                         unsigned maxExemplars = WarningCollectorDefaultExemplars,
+                                         size_t maxDetails = WarningCollectorDefaultMaxDetails);
+
+void WarningCollectorReport(WarningKind kind, const std::string& details);
 void WarningCollectorReport(const std::string& module, const std::string& shortDescription, const std::string& details);
+bool WarningCollectorWantsDetails(WarningKind kind);
+
 void WarningCollecterWriteToLogFile(const std::string& filePath);
 void WarningCollectorSetCurrentEventAction(EventActionId eventActionId);
 }
@@ -579,6 +579,7 @@ SOURCES += \
     dom/NamedNodeMap.cpp \
     dom/NameNodeList.cpp \
     dom/Node.cpp \
+    dom/NodeReplayPath.cpp \
     dom/NodeFilterCondition.cpp \
     dom/NodeFilter.cpp \
     dom/NodeIterator.cpp \
@@ -1741,6 +1742,7 @@ HEADERS += \
     dom/NodeFilterCondition.h \
     dom/NodeFilter.h \
     dom/Node.h \
+    dom/NodeReplayPath.h \
     dom/NodeIterator.h \
     dom/NodeRenderingContext.h \
     dom/Notation.h \
@@ -2335,6 +2337,7 @@ HEADERS += \
     platform/network/ProxyServer.h \
     platform/network/qt/QtMIMETypeSniffer.h \
     platform/network/qt/QNetworkReplyHandler.h \
+    platform/network/qt/QNetworkSnapshotBodyStore.h \
     platform/network/ResourceErrorBase.h \
     platform/network/ResourceHandle.h \
     platform/network/ResourceLoadInfo.h \
@@ -2881,6 +2884,7 @@ SOURCES += \
     platform/network/qt/ProxyServerQt.cpp \
     platform/network/qt/QtMIMETypeSniffer.cpp \
     platform/network/qt/QNetworkReplyHandler.cpp \
+    platform/network/qt/QNetworkSnapshotBodyStore.cpp \
     editing/qt/EditorQt.cpp \
     platform/Cursor.cpp \
     platform/qt/ClipboardQt.cpp \
@@ -50,6 +50,9 @@ namespace WebCore {
         bool isAttribute() const { return m_isAttribute; }
 
         JSC::JSObject* jsFunction(ScriptExecutionContext*) const;
+
+        // WebERA: The function, without initializing lazy listeners
+        JSC::JSObject* jsFunctionIfInitialized() const { return m_jsFunction.get(); }
         DOMWrapperWorld* isolatedWorld() const { return m_isolatedWorld.get(); }
 
         JSC::JSObject* wrapper() const { return m_wrapper.get(); }
@@ -129,4 +129,22 @@ bool eventListenerHandlerLocation(Document* document, EventListener* eventListen
     return true;
 }
 
+String eventListenerHandlerIdentity(EventListener* eventListener)
+{
+    const JSEventListener* jsListener = JSEventListener::cast(eventListener);
+    if (!jsListener)
+        return String();
+    // Do not compile lazy attribute handlers, that would be observable in the action log
+    JSC::JSObject* jsObject = jsListener->jsFunctionIfInitialized();
+    if (!jsObject)
+        return String();
+    JSC::JSFunction* jsFunction = jsDynamicCast<JSFunction*>(jsObject);
+    if (!jsFunction || jsFunction->isHostFunction())
+        return String();
+    const JSC::SourceCode& source = jsFunction->jsExecutable()->source();
+    if (!source.provider())
+        return String();
+    return String::format("%d:%d", source.provider()->actionLogJsId(), source.startOffset());
+}
+
 } // namespace WebCore
@@ -47,6 +47,9 @@ namespace WebCore {
     PassRefPtr<JSLazyEventListener> createAttributeEventListener(Frame*, Attribute*);
     String eventListenerHandlerBody(Document*, EventListener*);
     bool eventListenerHandlerLocation(Document*, EventListener*, String& sourceName, int& lineNumber);
+
+    // WebERA: Identifies the handler function as <JavaScript source id>:<offset>, or empty if the handler is not compiled yet
+    String eventListenerHandlerIdentity(EventListener*);
 } // namespace WebCore
 
 #endif // ScriptEventListener_h
@@ -48,6 +48,9 @@ namespace WebCore {
     String eventListenerHandlerBody(Document*, EventListener*);
     bool eventListenerHandlerLocation(Document*, EventListener*, String& sourceName, int& lineNumber);
 
+    // WebERA: Handler identities are only available with JSC
+    inline String eventListenerHandlerIdentity(EventListener*) { return String(); }
+
 } // namespace WebCore
 
 #endif // ScriptEventListener_h
@@ -23,9 +23,12 @@
 #include "config.h"
 #include "ContainerNode.h"
 
+#include "Attribute.h"
 #include "ChildListMutationScope.h"
 #include "ContainerNodeAlgorithms.h"
 #include "DeleteButtonController.h"
+#include "Element.h"
+#include "ElementAttributeData.h"
 #include "EventNames.h"
 #include "ExceptionCode.h"
 #include "FloatRect.h"
@@ -41,6 +44,7 @@
 #include "RenderTheme.h"
 #include "RootInlineBox.h"
 #include <wtf/CurrentTime.h>
+#include <wtf/HashFunctions.h>
 #include <wtf/Vector.h>
 
 using namespace std;
@@ -686,14 +690,76 @@ void ContainerNode::detach()
     Node::detach();
 }
 
-void ContainerNode::childrenChanged(bool changedByParser, Node*, Node*, int childCountDelta)
+void ContainerNode::childrenChanged(bool changedByParser, Node*, Node* afterChange, int childCountDelta)
 {
     document()->incDOMTreeVersion();
+    invalidateStructuralHash();
+    // WebERA: Inserting or removing a child moves the children following it
+    if (childCountDelta && afterChange && inDocument())
+        document()->replayPathsShifted(afterChange);
     if (!changedByParser && childCountDelta)
         document()->updateRangesAfterChildrenChanged(this);
     invalidateNodeListsCacheAfterChildrenChanged();
 }
 
+static inline unsigned structuralHashCombine(unsigned hash, unsigned value)
+{
+    return WTF::intHash((static_cast<uint64_t>(hash) << 32) | value);
+}
+
+static inline unsigned structuralStringHash(const String& string)
+{
+    return string.isNull() ? 0 : string.impl()->hash();
+}
+
+unsigned ContainerNode::structuralHash() const
+{
+    if (getFlag(IsStructuralHashValidFlag))
+        return m_structuralHash;
+
+    unsigned hash = nodeType();
+
+    if (isElementNode()) {
+        const Element* element = static_cast<const Element*>(this);
+
+        hash = structuralHashCombine(hash, structuralStringHash(element->tagQName().localName()));
+        hash = structuralHashCombine(hash, structuralStringHash(element->namespaceURI()));
+
+        // Serializes the inline style (and SVG animated attributes) into attributes first, as toHtml() would. Any
+        // resulting attribute change only invalidates this node, which is already invalid.
+        if (ElementAttributeData* attributeData = element->updatedAttributeData()) {
+            for (unsigned i = 0; i < attributeData->length(); ++i) {
+                Attribute* attribute = attributeData->attributeItem(i);
+                hash = structuralHashCombine(hash, structuralStringHash(attribute->name().localName()));
+                hash = structuralHashCombine(hash, structuralStringHash(attribute->value()));
+            }
+        }
+    }
+
+    for (Node* child = firstChild(); child; child = child->nextSibling()) {
+        unsigned childHash;
+
+        if (child->isContainerNode())
+            childHash = toContainerNode(child)->structuralHash();
+        else
+            childHash = structuralHashCombine(child->nodeType(), structuralStringHash(child->nodeValue()));
+
+        hash = structuralHashCombine(hash, childHash);
+    }
+
+    m_structuralHash = hash;
+    setFlag(IsStructuralHashValidFlag);
+
+    return hash;
+}
+
+void ContainerNode::invalidateStructuralHash()
+{
+    // An invalid node never has valid ancestors, thus we can stop at the first invalid node
+    for (ContainerNode* node = this; node && node->getFlag(IsStructuralHashValidFlag); node = node->parentNode())
+        node->clearFlag(IsStructuralHashValidFlag);
+}
+
 void ContainerNode::cloneChildNodes(ContainerNode *clone)
 {
     // disable the delete button so it's elements are not serialized into the markup
@@ -94,6 +94,12 @@ public:
     void detachChildren();
     void detachChildrenIfNeeded();
 
+    // WebERA: Hash of the structure of this subtree (tags, attributes and text), used to fingerprint the DOM after a replay.
+    // The hash is cached per container node. Mutations invalidate the cached hashes on the path to the root, such that
+    // reading the hash only recomputes the subtrees which changed since it was last read.
+    unsigned structuralHash() const;
+    void invalidateStructuralHash();
+
 protected:
     ContainerNode(Document*, ConstructionType = CreateContainer);
 
@@ -122,6 +128,8 @@ private:
 
     Node* m_firstChild;
     Node* m_lastChild;
+
+    mutable unsigned m_structuralHash;
 };
 
 inline ContainerNode* toContainerNode(Node* node)
@@ -143,6 +151,7 @@ inline ContainerNode::ContainerNode(Document* document, ConstructionType type)
     : Node(document, type)
     , m_firstChild(0)
     , m_lastChild(0)
+    , m_structuralHash(0)
 {
 }
 
@@ -493,6 +493,7 @@ Document::Document(Frame* frame, const KURL& url, bool isXHTML, bool isHTML)
 #endif
     , m_lastPendingTasksEventAction(0)
     , m_lastPendingStylesheetEventAction(0)
+    , m_replayIdentifierIndexBuilt(false)
 {
     m_document = this;
 
@@ -2655,6 +2656,13 @@ void Document::updateBaseURL()
         m_elemSheet->internal()->parserSetUsesRemUnits(usesRemUnits);
     }
 
+    // WebERA: Anchors contain the base URL, the index is built again on the next lookup
+    if (oldBaseURL != m_baseURL) {
+        m_replayPaths.clear();
+        m_replayIdentifierIndex.clear();
+        m_replayIdentifierIndexBuilt = false;
+    }
+
     if (!equalIgnoringFragmentIdentifier(oldBaseURL, m_baseURL)) {
         // Base URL change changes any relative visited links.
         // FIXME: There are other URLs in the tree that would need to be re-evaluated on dynamic base URL change. Style should be invalidated too.
@@ -6027,6 +6035,165 @@ IntSize Document::viewportSize() const
     return view()->visibleContentRect(/* includeScrollbars */ true).size();
 }
 
+Element* Document::elementByReplayIdentifier(const String& identifier)
+{
+    if (!m_replayIdentifierIndexBuilt)
+        buildReplayIdentifierIndex();
+
+    ReplayIdentifierIndex::iterator iter = m_replayIdentifierIndex.find(identifier);
+    if (iter == m_replayIdentifierIndex.end())
+        return 0;
+
+    const Vector<Element*, 1>& elements = iter->second;
+
+    Element* first = elements[0];
+    for (size_t i = 1; i < elements.size(); ++i) {
+        if (elements[i]->compareDocumentPosition(first) & DOCUMENT_POSITION_FOLLOWING)
+            first = elements[i];
+    }
+
+    return first;
+}
+
+NodeReplayPath* Document::nodeReplayPath(const Node* node)
+{
+    ASSERT(node->document() == this && node->inDocument());
+
+    ReplayPathMap::iterator iter = m_replayPaths.find(node);
+    if (iter != m_replayPaths.end())
+        return iter->second.get();
+
+    // The path of the parent is looked up (and cached) first, such that siblings share it
+    RefPtr<NodeReplayPath> path;
+    ContainerNode* parent = node->parentNode();
+
+    if (node->hasID() || !parent)
+        path = node->computeNodeReplayPath();
+    else
+        path = NodeReplayPath::create(nodeReplayPath(parent), node->nodeName(), replaySiblingIndex(node));
+
+    NodeReplayPath* result = path.get();
+    m_replayPaths.set(node, path.release());
+    return result;
+}
+
+unsigned Document::replaySiblingIndex(const Node* node) const
+{
+    // Children are mostly appended, thus count back to the closest previous sibling whose path is known
+    unsigned offset = 0;
+    for (Node* previous = node->previousSibling(); previous; previous = previous->previousSibling()) {
+        ++offset;
+
+        ReplayPathMap::const_iterator iter = m_replayPaths.find(previous);
+        if (iter != m_replayPaths.end() && !iter->second->isAnchor())
+            return iter->second->index() + offset;
+    }
+
+    return offset;
+}
+
+void Document::replayPathInserted(Node* node)
+{
+    // Called for each node of the inserted subtree, parents first
+    if (m_replayIdentifierIndexBuilt && node->isElementNode() && node->treeScope() == this)
+        addToReplayIdentifierIndex(toElement(node));
+}
+
+void Document::replayPathsShifted(Node* first)
+{
+    if (m_replayPaths.isEmpty())
+        return;
+
+    // Elements with an ID are anchors, their paths do not depend on their position
+    Vector<Element*> unindexed;
+    for (Node* node = first; node; node = node->nextSibling()) {
+        if (!node->hasID())
+            dropReplayPaths(node, unindexed);
+    }
+
+    for (size_t i = 0; i < unindexed.size(); ++i)
+        addToReplayIdentifierIndex(unindexed[i]);
+}
+
+void Document::replayPathRemoved(Node* node)
+{
+    // Called for each node of the removed subtree
+    ReplayPathMap::iterator iter = m_replayPaths.find(node);
+    if (iter == m_replayPaths.end())
+        return;
+
+    if (m_replayIdentifierIndexBuilt && node->isElementNode())
+        removeFromReplayIdentifierIndex(iter->second->toString(), toElement(node));
+
+    m_replayPaths.remove(iter);
+}
+
+void Document::replayPathAnchorChanged(Element* element)
+{
+    if (m_replayPaths.isEmpty())
+        return;
+
+    Vector<Element*> unindexed;
+    dropReplayPaths(element, unindexed);
+
+    for (size_t i = 0; i < unindexed.size(); ++i)
+        addToReplayIdentifierIndex(unindexed[i]);
+}
+
+void Document::dropReplayPaths(Node* root, Vector<Element*>& unindexed)
+{
+    // Paths are only cached together with the path of their parent, thus nothing below an uncached node is cached,
+    // except for anchors, whose paths are independent of root. Indexed elements are collected in document order.
+    ReplayPathMap::iterator iter = m_replayPaths.find(root);
+    if (iter == m_replayPaths.end())
+        return;
+
+    if (m_replayIdentifierIndexBuilt && root->isElementNode() && removeFromReplayIdentifierIndex(iter->second->toString(), toElement(root)))
+        unindexed.append(toElement(root));
+
+    m_replayPaths.remove(iter);
+
+    for (Node* child = root->firstChild(); child; child = child->nextSibling()) {
+        if (!child->hasID())
+            dropReplayPaths(child, unindexed);
+    }
+}
+
+void Document::buildReplayIdentifierIndex()
+{
+    m_replayIdentifierIndexBuilt = true;
+
+    for (Node* node = firstChild(); node; node = node->traverseNextNode()) {
+        if (node->isElementNode())
+            addToReplayIdentifierIndex(toElement(node));
+    }
+}
+
+void Document::addToReplayIdentifierIndex(Element* element)
+{
+    const String& identifier = nodeReplayPath(element)->toString();
+    m_replayIdentifierIndex.add(identifier, Vector<Element*, 1>()).iterator->second.append(element);
+}
+
+bool Document::removeFromReplayIdentifierIndex(const String& identifier, Element* element)
+{
+    ReplayIdentifierIndex::iterator iter = m_replayIdentifierIndex.find(identifier);
+    if (iter == m_replayIdentifierIndex.end())
+        return false;
+
+    Vector<Element*, 1>& elements = iter->second;
+
+    size_t position = elements.find(element);
+    if (position == notFound)
+        return false;
+
+    elements.remove(position);
+    if (elements.isEmpty())
+        m_replayIdentifierIndex.remove(iter);
+
+    return true;
+}
+
 Node* eventTargetNodeForDocument(Document* doc)
 {
     if (!doc)
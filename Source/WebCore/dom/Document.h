@@ -39,6 +39,7 @@
 #include "InspectorCounters.h"
 #include "IntRect.h"
 #include "LayoutTypes.h"
+#include "NodeReplayPath.h"
 #include "PageVisibilityState.h"
 #include "PlatformScreen.h"
 #include "QualifiedName.h"
@@ -942,6 +943,19 @@ public:
     void incDOMTreeVersion() { m_domTreeVersion = ++s_globalTreeVersion; }
     uint64_t domTreeVersion() const { return m_domTreeVersion; }
 
+    // WebERA: Element with the given Node::getNodeReplayIdentifier, or 0. The index is built in one traversal on the
+    // first lookup, and from then on kept up to date by the replayPath* notifications below.
+    Element* elementByReplayIdentifier(const String& identifier);
+
+    // WebERA: Replay path of a node in this document. Paths are cached per node, and dropped for the subtrees of
+    // nodes whose path changes (see the replayPath* notifications below), or when the base URL changes.
+    NodeReplayPath* nodeReplayPath(const Node*);
+
+    void replayPathInserted(Node*); // the node was inserted into the document
+    void replayPathsShifted(Node* first); // the sibling index of first and its following siblings changed
+    void replayPathRemoved(Node*); // the node was removed from the document
+    void replayPathAnchorChanged(Element*); // the ID of the element changed
+
     void setDocType(PassRefPtr<DocumentType>);
 
     // XPathEvaluator methods
@@ -1520,6 +1534,21 @@ private:
     MultiJoinHappensBefore m_addedPendingTaskJoin;
     WTF::EventActionId m_lastPendingTasksEventAction;
     WTF::EventActionId m_lastPendingStylesheetEventAction;
+
+    void buildReplayIdentifierIndex();
+    void addToReplayIdentifierIndex(Element*);
+    bool removeFromReplayIdentifierIndex(const String& identifier, Element*);
+
+    // Identifiers collide for duplicate IDs, the first element in document order is returned for those
+    typedef HashMap<String, Vector<Element*, 1> > ReplayIdentifierIndex;
+    ReplayIdentifierIndex m_replayIdentifierIndex; // elements of this tree scope, paths of all of them are cached
+    bool m_replayIdentifierIndexBuilt;
+
+    unsigned replaySiblingIndex(const Node*) const;
+    void dropReplayPaths(Node* root, Vector<Element*>& unindexed);
+
+    typedef HashMap<const Node*, RefPtr<NodeReplayPath> > ReplayPathMap;
+    ReplayPathMap m_replayPaths; // nodes in the document whose path was requested, and their ancestors
 };
 
 // Put these methods here, because they require the Document definition, but we really want to inline them.
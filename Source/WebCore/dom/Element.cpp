@@ -701,6 +701,7 @@ inline void Element::setAttributeInternal(size_t index, const QualifiedName& nam
 void Element::attributeChanged(Attribute* attr)
 {
     document()->incDOMTreeVersion();
+    invalidateStructuralHash();
 
     if (isIdAttributeName(attr->name()))
         idAttributeChanged(attr);
@@ -754,6 +755,10 @@ void Element::idAttributeChanged(Attribute* attr)
             attributeData()->setIdForStyleResolution(attr->value());
     }
     setNeedsStyleRecalc();
+
+    // WebERA: Elements with an ID anchor the replay paths of their subtree
+    if (inDocument())
+        document()->replayPathAnchorChanged(this);
 }
     
 // Returns true is the given attribute is an event handler.
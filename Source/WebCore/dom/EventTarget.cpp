@@ -33,12 +33,16 @@
 #include "config.h"
 #include "EventTarget.h"
 
+#include "Element.h"
 #include "Event.h"
 #include "EventException.h"
+#include "HTMLNames.h"
 #include "InspectorInstrumentation.h"
+#include "ScriptEventListener.h"
 #include <wtf/ActionLogReport.h>
 #include <wtf/MainThread.h>
 #include <wtf/StdLibExtras.h>
+#include <wtf/text/CString.h>
 #include <wtf/Vector.h>
 
 using namespace WTF;
@@ -107,6 +111,16 @@ void EventTargetAccess(ActionLog::CommandType command, EventTarget* target, cons
 			static_cast<void*>(node ? node : target),
 			eventType);
 }
+
+// WebERA: Tag and class of the target, auto-exploration prefers targets it has not seen yet
+std::string explorationSignature(Node* node) {
+	String signature = node->nodeName();
+	if (node->isElementNode() && toElement(node)->hasClass()) {
+		signature.append(".");
+		signature.append(toElement(node)->getAttribute(HTMLNames::classAttr).string());
+	}
+	return signature.utf8().data();
+}
 }  // namespace
 
 bool EventTarget::addEventListener(const AtomicString& eventType, PassRefPtr<EventListener> listener, bool useCapture)
@@ -119,7 +133,13 @@ bool EventTarget::addEventListener(const AtomicString& eventType, PassRefPtr<Eve
     // SRL: Note that an event listener was added for the auto-exploration to run it later.
     if (toNode() != 0) { // WebERA: && !toNode()->baseURI().string().isNull() <-- problematic on some websites?
         // don't add nodes without a baseURI, we cant find them again
-        getEventAttachLog()->addEventStr(toNode(), eventType.string().ascii().data());
+        CString eventTypeStr = eventType.string().ascii();
+
+        if (EventAttachLog::isExplorable(eventTypeStr.data())) {
+            getEventAttachLog()->addEventStr(toNode(), eventTypeStr.data(),
+                                             eventListenerHandlerIdentity(listener.get()).utf8().data(),
+                                             explorationSignature(toNode()));
+        }
     }
 
     EventTargetData* d = ensureEventTargetData();
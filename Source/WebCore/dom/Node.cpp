@@ -70,6 +70,7 @@
 #include "NameNodeList.h"
 #include "NamedNodeMap.h"
 #include "NodeRareData.h"
+#include "NodeReplayPath.h"
 #include "NodeRenderingContext.h"
 #include "Page.h"
 #include "PlatformMouseEvent.h"
@@ -398,9 +399,10 @@ void Node::trackForDebugging()
 
 Node::~Node()
 {
-#ifndef NDEBUG
+    // WebERA: Removal is cheap, never leave a dangling node for the auto-exploration
     getEventAttachLog()->removeEventTarget(this);
 
+#ifndef NDEBUG
     HashSet<Node*>::iterator it = ignoreSet.find(this);
     if (it != ignoreSet.end())
         ignoreSet.remove(it);
@@ -1325,32 +1327,25 @@ bool Node::containsIncludingShadowDOM(Node* node)
 }
 
 // WebERA: The node identifier should be usable for finding the node again.
-String Node::getNodeReplayIdentifier() const {
-	if (isElementNode()) {
-		const Element* el = toElement(this);
-		if (el->hasID()) {
-            String uri = baseURI().string();
-			String id = el->getIdAttribute().string();
-			return String::format("%s @ ID=%s",
-                    uri.isNull() ? "-empty-" : uri.utf8().data(),
-					id.isNull() ? "" : id.utf8().data());
-		}
-	}
-	String name = nodeName();
-
-	ContainerNode* parent = parentNode();
-	if (parent) {
-		return String::format("%s/%s[%d]",
-				parent->getNodeReplayIdentifier().utf8().data(),
-				name.isNull() ? "" : name.utf8().data(),
-				nodeIndex());
-	}
-
-	String uri = baseURI().string();
-	return String::format("%s @ %s[%d]",
-            uri.isNull() ? "-empty-" : uri.utf8().data(),
-			name.isNull() ? "" : name.utf8().data(),
-			nodeIndex());
+String Node::getNodeReplayIdentifier() const
+{
+    if (inDocument())
+        return document()->nodeReplayPath(this)->toString();
+
+    return computeNodeReplayPath()->toString();
+}
+
+PassRefPtr<NodeReplayPath> Node::computeNodeReplayPath() const
+{
+    if (hasID())
+        return NodeReplayPath::anchoredAtId(baseURI().string(), toElement(this)->getIdAttribute().string());
+
+    ContainerNode* parent = parentNode();
+    if (!parent)
+        return NodeReplayPath::anchoredAtRoot(baseURI().string(), nodeName(), nodeIndex());
+
+    RefPtr<NodeReplayPath> parentPath = parent->inDocument() ? parent->document()->nodeReplayPath(parent) : parent->computeNodeReplayPath();
+    return NodeReplayPath::create(parentPath.release(), nodeName(), nodeIndex());
 }
 
 void Node::attach()
@@ -2428,16 +2423,20 @@ ScriptExecutionContext* Node::scriptExecutionContext() const
 Node::InsertionNotificationRequest Node::insertedInto(Node* insertionPoint)
 {
     ASSERT(insertionPoint->inDocument() || isContainerNode());
-    if (insertionPoint->inDocument())
+    if (insertionPoint->inDocument()) {
         setFlag(InDocumentFlag);
+        insertionPoint->document()->replayPathInserted(this);
+    }
     return InsertionDone;
 }
 
 void Node::removedFrom(Node* insertionPoint)
 {
     ASSERT(insertionPoint->inDocument() || isContainerNode());
-    if (insertionPoint->inDocument())
+    if (insertionPoint->inDocument()) {
         clearFlag(InDocumentFlag);
+        insertionPoint->document()->replayPathRemoved(this);
+    }
 }
 
 void Node::didMoveToNewDocument(Document* oldDocument)
@@ -72,6 +72,7 @@ class NamedNodeMap;
 class NameNodeList;
 class NodeList;
 class NodeRareData;
+class NodeReplayPath;
 class NodeRenderingContext;
 class PlatformKeyboardEvent;
 class PlatformMouseEvent;
@@ -150,6 +151,9 @@ public:
     // WebERA: Node identifier used to replay traces.
     String getNodeReplayIdentifier() const;
 
+    // WebERA: Uncached path of this node, use Document::nodeReplayPath for nodes in the document
+    PassRefPtr<NodeReplayPath> computeNodeReplayPath() const;
+
     // DOM methods & attributes for Node
 
     bool hasTagName(const QualifiedName&) const;
@@ -687,6 +691,8 @@ private:
 
         AttributeStyleDirtyFlag = 1 << 27,
 
+        IsStructuralHashValidFlag = 1 << 28, // ContainerNode
+
 #if ENABLE(SVG)
         DefaultNodeFlags = IsParsingChildrenFinishedFlag | IsStyleAttributeValidFlag | AreSVGAttributesValidFlag,
 #else
@@ -695,7 +701,7 @@ private:
         InNamedFlowFlag = 1 << 29
     };
 
-    // 3 bits remaining
+    // 2 bits remaining
 
     bool getFlag(NodeFlags mask) const { return m_nodeFlags & mask; }
     void setFlag(bool f, NodeFlags mask) const { m_nodeFlags = (m_nodeFlags & ~mask) | (-(int32_t)f & mask); } 
@@ -0,0 +1,112 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "NodeReplayPath.h"
+
+#include <wtf/Vector.h>
+#include <wtf/text/CString.h>
+#include <wtf/text/StringBuilder.h>
+
+namespace WebCore {
+
+// Identifiers used to be built with nested String::format("%s", ...utf8()) calls, which store the UTF-8 bytes as
+// Latin-1 characters. Non-ASCII characters are thus encoded again at each level, keep doing so for existing schedules.
+static String latin1FromUTF8(const String& string)
+{
+    if (string.containsOnlyASCII())
+        return string;
+
+    CString utf8 = string.utf8();
+    return String(reinterpret_cast<const LChar*>(utf8.data()), utf8.length());
+}
+
+PassRefPtr<NodeReplayPath> NodeReplayPath::anchoredAtId(const String& baseURI, const String& id)
+{
+    StringBuilder anchor;
+    anchor.append(baseURI.isNull() ? String("-empty-") : latin1FromUTF8(baseURI));
+    anchor.append(" @ ID=");
+    anchor.append(latin1FromUTF8(id));
+
+    RefPtr<NodeReplayPath> path = adoptRef(new NodeReplayPath);
+    path->m_identifier = anchor.toString();
+    return path.release();
+}
+
+PassRefPtr<NodeReplayPath> NodeReplayPath::anchoredAtRoot(const String& baseURI, const String& name, unsigned index)
+{
+    StringBuilder anchor;
+    anchor.append(baseURI.isNull() ? String("-empty-") : latin1FromUTF8(baseURI));
+    anchor.append(" @ ");
+    anchor.append(latin1FromUTF8(name));
+    anchor.append('[');
+    anchor.append(String::number(index));
+    anchor.append(']');
+
+    RefPtr<NodeReplayPath> path = adoptRef(new NodeReplayPath);
+    path->m_identifier = anchor.toString();
+    return path.release();
+}
+
+PassRefPtr<NodeReplayPath> NodeReplayPath::create(PassRefPtr<NodeReplayPath> parent, const AtomicString& name, unsigned index)
+{
+    RefPtr<NodeReplayPath> path = adoptRef(new NodeReplayPath);
+    path->m_parent = parent;
+    path->m_name = name;
+    path->m_index = index;
+    return path.release();
+}
+
+const String& NodeReplayPath::toString() const
+{
+    if (!m_identifier.isNull())
+        return m_identifier;
+
+    // Walk up to the closest path with a known identifier (at the latest the anchor), and memoize on the way down,
+    // such that the siblings and descendants of this node only append their own step
+    Vector<const NodeReplayPath*, 16> unknown;
+    for (const NodeReplayPath* path = this; path->m_identifier.isNull(); path = path->m_parent.get())
+        unknown.append(path);
+
+    for (size_t i = unknown.size(); i > 0; --i) {
+        const NodeReplayPath* path = unknown[i - 1];
+        path->m_identifier = appendStep(path->m_parent->m_identifier, path->m_name, path->m_index);
+    }
+
+    return m_identifier;
+}
+
+String NodeReplayPath::appendStep(const String& identifier, const String& name, unsigned index)
+{
+    StringBuilder builder;
+    builder.append(latin1FromUTF8(identifier));
+    builder.append('/');
+    builder.append(latin1FromUTF8(name));
+    builder.append('[');
+    builder.append(String::number(index));
+    builder.append(']');
+
+    return builder.toString();
+}
+
+} // namespace WebCore
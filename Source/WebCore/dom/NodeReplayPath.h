@@ -0,0 +1,69 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NodeReplayPath_h
+#define NodeReplayPath_h
+
+#include <wtf/PassRefPtr.h>
+#include <wtf/RefCounted.h>
+#include <wtf/RefPtr.h>
+#include <wtf/text/AtomicString.h>
+#include <wtf/text/WTFString.h>
+
+namespace WebCore {
+
+// WebERA: Compact form of Node::getNodeReplayIdentifier.
+//
+// A path is an anchor (an element with an ID, or a node without parent), or the path of the parent node followed by
+// the name and sibling index of the node. Paths of siblings share the path of their parent. The textual identifier is
+// only produced by toString, and is memoized along the way.
+class NodeReplayPath : public RefCounted<NodeReplayPath> {
+public:
+    static PassRefPtr<NodeReplayPath> anchoredAtId(const String& baseURI, const String& id);
+    static PassRefPtr<NodeReplayPath> anchoredAtRoot(const String& baseURI, const String& name, unsigned index);
+    static PassRefPtr<NodeReplayPath> create(PassRefPtr<NodeReplayPath> parent, const AtomicString& name, unsigned index);
+
+    bool isAnchor() const { return !m_parent; }
+    unsigned index() const { return m_index; } // sibling index, only for paths which are not anchors
+
+    const String& toString() const;
+
+    // <identifier>/<name>[<index>], as produced by toString for each step
+    static String appendStep(const String& identifier, const String& name, unsigned index);
+
+private:
+    NodeReplayPath()
+        : m_index(0)
+    {
+    }
+
+    RefPtr<NodeReplayPath> m_parent;
+    AtomicString m_name;
+    unsigned m_index;
+
+    mutable String m_identifier; // the anchor itself for anchors
+};
+
+} // namespace WebCore
+
+#endif // NodeReplayPath_h
@@ -187,6 +187,7 @@ void StyledElement::inlineStyleChanged()
 {
     setNeedsStyleRecalc(InlineStyleChange);
     setIsStyleAttributeValid(false);
+    invalidateStructuralHash();
     InspectorInstrumentation::didInvalidateStyleAttr(document(), this);
 }
     
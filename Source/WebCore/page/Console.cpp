@@ -209,7 +209,7 @@ void Console::addMessage(MessageSource source, MessageType type, MessageLevel le
     std::stringstream name;
     name << sourceString << " (" << levelString << ")";
 
-    WTF::WarningCollectorReport("console.log", name.str(), message.ascii().data());
+    WTF::WarningCollectorReport(WTF::WarningCollectorRegisterKind("console.log", name.str(), WTF::WarningCollectorComparedExemplars), message.ascii().data());
 
     if (!Console::shouldPrintExceptions())
         return;
@@ -276,7 +276,7 @@ void Console::addMessage(MessageType type, MessageLevel level, PassRefPtr<Script
         name << "CONSOLE (" << levelString << ")";
 
 
-        WTF::WarningCollectorReport("console.log", name.str(), message.ascii().data());
+        WTF::WarningCollectorReport(WTF::WarningCollectorRegisterKind("console.log", name.str(), WTF::WarningCollectorComparedExemplars), message.ascii().data());
         page->chrome()->client()->addMessageToConsole(ConsoleAPIMessageSource, type, level, message, lastCaller.lineNumber(), lastCaller.sourceURL());
     }
 
@@ -21,6 +21,7 @@
 
 #include <limits>
 #include <sstream>
+#include <vector>
 
 #include "config.h"
 #include "QNetworkReplyHandler.h"
@@ -33,6 +34,8 @@
 #include "ResourceHandleInternal.h"
 #include "ResourceResponse.h"
 #include "ResourceRequest.h"
+#include "ThreadGlobalData.h"
+#include "ThreadTimers.h"
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
@@ -43,6 +46,7 @@
 
 #include <wtf/EventActionDescriptor.h>
 #include <wtf/ActionLogReport.h>
+#include <wtf/warningcollectorreport.h>
 
 #include <wtf/text/CString.h>
 
@@ -257,13 +261,27 @@ QByteArray QNetworkReplyInitialSnapshot::peek(qint64 maxlen)
     return result;
 }
 
-void QNetworkReplyInitialSnapshot::serialize(QIODevice* stream) const
+void QNetworkReplyInitialSnapshot::serialize(QIODevice* stream, QNetworkSnapshotBodyStore* bodyStore) const
 {
     QDataStream out(stream);
-    out << m_headers;
+
+    QByteArray bodyHash;
+    if (bodyStore != 0 && bodyStore->shouldStore(m_stream)) {
+        bodyHash = bodyStore->put(m_stream); // kept in the network file if this fails
+    }
+
+    if (bodyHash.isEmpty()) {
+        out << m_headers;
+    } else {
+        // The reference is written as an extra header, such that network files without stored bodies read as before
+        QList<QNetworkReply::RawHeaderPair> headers = m_headers;
+        headers.append(QNetworkReply::RawHeaderPair(QNetworkSnapshotBodyStore::BODY_HEADER, bodyHash));
+        out << headers;
+    }
+
     out << m_sameUrlSequenceNumber;
     out << m_url;
-    out << m_stream;
+    out << (bodyHash.isEmpty() ? m_stream : QByteArray());
     out << m_cookies;
 
     foreach (const QNetworkReplySnapshotEntry& entry, m_snapshots) {
@@ -277,7 +295,7 @@ void QNetworkReplyInitialSnapshot::serialize(QIODevice* stream) const
     out << (int)END;
 }
 
-QNetworkReplyInitialSnapshot* QNetworkReplyInitialSnapshot::deserialize(QIODevice* stream)
+QNetworkReplyInitialSnapshot* QNetworkReplyInitialSnapshot::deserialize(QIODevice* stream, const QNetworkSnapshotBodyStore* bodyStore)
 {
     QNetworkReplyInitialSnapshot* initial = new QNetworkReplyInitialSnapshot();
 
@@ -289,10 +307,28 @@ QNetworkReplyInitialSnapshot* QNetworkReplyInitialSnapshot::deserialize(QIODevic
        >> initial->m_stream
        >> initial->m_cookies;
 
+    for (int i = 0; i < initial->m_headers.size(); ++i) {
+        if (initial->m_headers.at(i).first == QNetworkSnapshotBodyStore::BODY_HEADER) {
+            QByteArray bodyHash = initial->m_headers.takeAt(i).second;
+
+            if (bodyStore == 0 || !bodyStore->get(bodyHash, &initial->m_stream)) {
+                initial->m_missingBodyHash = bodyHash;
+            }
+
+            break;
+        }
+    }
+
     while (true) {
         int signal;
         in >> signal;
 
+        if (in.status() != QDataStream::Ok) {
+            // truncated, e.g. the tail of a network file streamed by a recorder which crashed
+            delete initial;
+            return 0;
+        }
+
         if ((NetworkSignal)signal == END) {
             // sentinel
             break;
@@ -373,6 +409,7 @@ QByteArray QNetworkReplySnapshot::rawHeader(const QByteArray &headerName) const
 
 QNetworkReplyControllable::QNetworkReplyControllable(QNetworkReplyControllableFactory* factory, QNetworkReply* reply, QNetworkReplyInitialSnapshot* initialSnapshot, QObject* parent)
     : QObject(parent)
+    , m_released(false)
     , m_sequenceNumber(0)
     , m_nextSnapshotUpdateTimerRunning(false)
     , m_nextSnapshotUpdateTimer(this, &QNetworkReplyControllable::updateSnapshot)
@@ -410,6 +447,7 @@ void QNetworkReplyControllable::detachFromReply()
     }
 
     m_snapshotQueue.clear();
+    m_heldSnapshots.clear();
 
     QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
 }
@@ -459,6 +497,7 @@ void QNetworkReplyControllable::updateSnapshot(Timer<QNetworkReplyControllable>*
 
     switch(queuedSnapshot.first) {
     case QNetworkReplyInitialSnapshot::FINISHED:
+        m_factory->controllableDelivered(this);
         emit finished();
         return; // We are done and this structure has been freed
     case QNetworkReplyInitialSnapshot::READY_READ:
@@ -471,11 +510,31 @@ void QNetworkReplyControllable::updateSnapshot(Timer<QNetworkReplyControllable>*
 
 void QNetworkReplyControllable::enqueueSnapshot(QNetworkReplyInitialSnapshot::NetworkSignal signal, QNetworkReplySnapshot* snapshot)
 {
+    if (m_factory->holdsSnapshots() && !m_released) {
+        m_heldSnapshots.append(QueuedSnapshot(signal, snapshot));
+        return;
+    }
+
     m_snapshotQueue.append(QueuedSnapshot(signal, snapshot));
 
     scheduleNextSnapshotUpdate();
 }
 
+bool QNetworkReplyControllable::releaseHeldSnapshots()
+{
+    m_released = true;
+
+    if (m_heldSnapshots.isEmpty() || !m_reply) {
+        return false;
+    }
+
+    m_snapshotQueue.append(m_heldSnapshots);
+    m_heldSnapshots.clear();
+
+    scheduleNextSnapshotUpdate();
+    return true;
+}
+
 void QNetworkReplyControllable::scheduleNextSnapshotUpdate()
 {
     if (m_nextSnapshotUpdateTimerRunning) {
@@ -517,6 +576,9 @@ void QNetworkReplyControllableLive::slFinished()
     // this is always handled by the main thread, Qt signal magic
     enqueueSnapshot(QNetworkReplyInitialSnapshot::FINISHED,
                     m_initialSnapshot->takeSnapshot(QNetworkReplyInitialSnapshot::FINISHED, m_reply));
+
+    // the snapshot is complete now
+    m_factory->controllableFinished(this);
 }
 
 void QNetworkReplyControllableLive::slReadyRead()
@@ -557,6 +619,8 @@ void QNetworkReplyControllableFactory::setFactory(QNetworkReplyControllableFacto
 
 QNetworkReplyControllableFactory::QNetworkReplyControllableFactory()
     : m_doneCounter(0)
+    , m_bodyStore(0)
+    , m_releaseGate(0)
 {
 }
 
@@ -567,29 +631,305 @@ QNetworkReplyControllableFactory::~QNetworkReplyControllableFactory()
 void QNetworkReplyControllableFactory::controllableDone(QNetworkReplyControllable* controllable)
 {
     m_doneCounter++;
+    m_openNetworkSessions.erase(controllable);
+
+    if (m_releaseGate != 0) {
+        m_releaseGate->forget(controllable);
+    }
+
+    if (m_streamFile.isOpen()) {
+        // Aborted requests are written as they are, the snapshot is not used after this point
+        QNetworkReplyInitialSnapshot* snapshot = controllable->initialSnapshot();
+        streamSnapshot(snapshot);
+        delete snapshot;
+    }
 }
 
 void QNetworkReplyControllableFactory::controllableConstructed(QNetworkReplyControllable* controllable)
 {
     m_networkHistory.push_back(controllable->initialSnapshot());
+    m_openNetworkSessions.insert(controllable);
+}
+
+void QNetworkReplyControllableFactory::controllableFinished(QNetworkReplyControllable* controllable)
+{
+    m_openNetworkSessions.erase(controllable);
+
+    if (m_streamFile.isOpen()) {
+        // The finished snapshot has been taken, the remaining snapshots are only replayed from memory
+        streamSnapshot(controllable->initialSnapshot());
+    }
+
+    if (m_releaseGate != 0) {
+        m_releaseGate->hold(controllable);
+    }
+}
+
+void QNetworkReplyControllableFactory::controllableDelivered(QNetworkReplyControllable* controllable)
+{
+    if (m_releaseGate != 0) {
+        m_releaseGate->delivered(controllable);
+    }
+}
+
+void QNetworkReplyControllableFactory::setSeededRelease(unsigned int seed)
+{
+    delete m_releaseGate;
+    m_releaseGate = new QNetworkReplyReleaseGate(this, seed);
+}
+
+QNetworkReplyReleaseGate::QNetworkReplyReleaseGate(QNetworkReplyControllableFactory* factory, unsigned int seed)
+    : QObject(0)
+    , m_factory(factory)
+    , m_releasing(0)
+    , m_random(seed ^ 0x49616E42)
+{
+    m_releaseTimer.setSingleShot(true);
+    connect(&m_releaseTimer, SIGNAL(timeout()), this, SLOT(releaseNext()));
+
+    m_stallTimer.setSingleShot(true);
+    m_stallTimer.setInterval(STALL_TIMEOUT);
+    connect(&m_stallTimer, SIGNAL(timeout()), this, SLOT(slStalled()));
+}
+
+void QNetworkReplyReleaseGate::hold(QNetworkReplyControllable* controllable)
+{
+    m_stalledRequests.erase(controllable);
+    m_held.push_back(controllable);
+    scheduleRelease();
+}
+
+void QNetworkReplyReleaseGate::delivered(QNetworkReplyControllable* controllable)
+{
+    if (controllable == m_releasing) {
+        m_releasing = 0;
+        scheduleRelease();
+    }
+}
+
+void QNetworkReplyReleaseGate::forget(QNetworkReplyControllable* controllable)
+{
+    m_held.remove(controllable);
+    m_stalledRequests.erase(controllable);
+
+    if (controllable == m_releasing) {
+        m_releasing = 0;
+    }
+
+    // An aborted request could be the last one in flight
+    scheduleRelease();
+}
+
+void QNetworkReplyReleaseGate::scheduleRelease(int delay)
+{
+    if (!m_releaseTimer.isActive() || delay < m_releaseTimer.interval()) {
+        m_releaseTimer.start(delay);
+    }
+}
+
+unsigned int QNetworkReplyReleaseGate::nextRandom()
+{
+    // xorshift32, the sequence only depends on the seed
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+// Requests in flight, except those which already stalled the gate (e.g. long-polling requests)
+unsigned int QNetworkReplyReleaseGate::awaitedCounter() const
+{
+    const std::set<QNetworkReplyControllable*>& inFlight = m_factory->inFlight();
+
+    unsigned int awaited = 0;
+    for (std::set<QNetworkReplyControllable*>::const_iterator iter = inFlight.begin(); iter != inFlight.end(); ++iter) {
+        if (m_stalledRequests.find(*iter) == m_stalledRequests.end()) {
+            ++awaited;
+        }
+    }
+
+    return awaited;
+}
+
+static bool releasedBefore(QNetworkReplyControllable* a, QNetworkReplyControllable* b)
+{
+    QString urlA = a->initialSnapshot()->getUrl().toString();
+    QString urlB = b->initialSnapshot()->getUrl().toString();
+
+    if (urlA != urlB) {
+        return urlA < urlB;
+    }
+
+    return a->initialSnapshot()->getSameUrlSequenceNumber() < b->initialSnapshot()->getSameUrlSequenceNumber();
+}
+
+void QNetworkReplyReleaseGate::releaseNext()
+{
+    if (m_releasing != 0 || m_held.empty()) {
+        return;
+    }
+
+    // Wait for all requests, the set of held replies should not depend on network timing
+    if (awaitedCounter() != 0) {
+        if (!m_stallTimer.isActive()) {
+            m_stallTimer.start();
+        }
+
+        return;
+    }
+
+    // Wait until the page has processed everything it can without new network input
+    const Vector<TimerBase*>& timers = threadGlobalData().threadTimers().timerHeap();
+    for (size_t i = 0; i < timers.size(); ++i) {
+        if (timers[i]->nextFireInterval() <= 0) {
+            scheduleRelease(1);
+            return;
+        }
+    }
+
+    m_stallTimer.stop();
+
+    std::vector<QNetworkReplyControllable*> candidates(m_held.begin(), m_held.end());
+    std::sort(candidates.begin(), candidates.end(), releasedBefore);
+
+    QNetworkReplyControllable* controllable = candidates[nextRandom() % candidates.size()];
+    m_held.remove(controllable);
+
+    m_releasing = controllable;
+
+    if (!controllable->releaseHeldSnapshots()) {
+        // Detached from its reply, nothing will be delivered
+        m_releasing = 0;
+        scheduleRelease();
+    }
+}
+
+void QNetworkReplyReleaseGate::slStalled()
+{
+    std::stringstream details;
+    details << awaitedCounter() << " requests still in flight after " << STALL_TIMEOUT << " ms, releasing finished replies without waiting for them.";
+
+    WTF::WarningCollectorReport("WEBERA_NETWORK", "Seeded network release stalled.", details.str());
+
+    const std::set<QNetworkReplyControllable*>& inFlight = m_factory->inFlight();
+    m_stalledRequests.insert(inFlight.begin(), inFlight.end());
+
+    releaseNext();
+}
+
+bool QNetworkReplyControllableFactory::streamNetworkFile(QString networkFilePath)
+{
+    ASSERT(!m_streamFile.isOpen());
+
+    m_streamFile.setFileName(networkFilePath);
+
+    if (!m_streamFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    // An index from an earlier recording would not match the network file
+    QFile::remove(networkIndexPath(networkFilePath));
+
+    if (m_bodyStore != 0) {
+        m_bodyStore->openReferences(networkFilePath);
+    }
+
+    return true;
+}
+
+void QNetworkReplyControllableFactory::appendSnapshot(QIODevice* fp, QList<NetworkIndexEntry>* index, WebCore::QNetworkReplyInitialSnapshot* snapshot)
+{
+    NetworkIndexEntry entry;
+    entry.url = snapshot->getUrl();
+    entry.sameUrlSequenceNumber = snapshot->getSameUrlSequenceNumber();
+    entry.offset = fp->pos();
+
+    snapshot->serialize(fp, m_bodyStore);
+
+    entry.length = fp->pos() - entry.offset;
+    index->append(entry);
+}
+
+void QNetworkReplyControllableFactory::streamSnapshot(WebCore::QNetworkReplyInitialSnapshot* snapshot)
+{
+    // In flight requests are few, a linear search is fine
+    std::list<WebCore::QNetworkReplyInitialSnapshot*>::iterator iter = std::find(m_networkHistory.begin(), m_networkHistory.end(), snapshot);
+
+    if (iter == m_networkHistory.end()) {
+        return; // already written
+    }
+
+    m_networkHistory.erase(iter);
+
+    appendSnapshot(&m_streamFile, &m_streamIndex, snapshot);
+
+    // Whatever has been written survives a crash of the recorder
+    m_streamFile.flush();
+}
+
+void QNetworkReplyControllableFactory::writeNetworkIndex(QString networkFilePath, const QList<NetworkIndexEntry>& index)
+{
+    // The index allows readers to locate (and lazily deserialize) individual snapshots, see networkIndexPath
+
+    QFile indexFp(networkIndexPath(networkFilePath));
+    indexFp.open(QIODevice::WriteOnly);
+
+    ASSERT(indexFp.isOpen());
+
+    QDataStream out(&indexFp);
+    out << NETWORK_INDEX_MAGIC << NETWORK_INDEX_VERSION;
+
+    foreach (const NetworkIndexEntry& entry, index) {
+        out << entry.url << entry.sameUrlSequenceNumber << entry.offset << entry.length;
+    }
+
+    indexFp.close();
 }
 
 void QNetworkReplyControllableFactory::writeNetworkFile(QString networkFilePath)
 {
+    if (m_streamFile.isOpen() && QFileInfo(m_streamFile).absoluteFilePath() == QFileInfo(networkFilePath).absoluteFilePath()) {
+
+        // Requests still in flight are written as they are
+        while (!m_networkHistory.empty()) {
+            streamSnapshot(m_networkHistory.front());
+        }
+
+        m_streamFile.close();
+
+        writeNetworkIndex(networkFilePath, m_streamIndex);
+        m_streamIndex.clear();
+
+        if (m_bodyStore != 0) {
+            m_bodyStore->closeReferences();
+        }
+
+        return;
+    }
+
     QFile fp(networkFilePath);
     fp.open(QIODevice::WriteOnly);
 
     ASSERT(fp.isOpen());
 
-    std::list<WebCore::QNetworkReplyInitialSnapshot*> networkHistory = m_networkHistory;
-    while (!networkHistory.empty()) {
-        WebCore::QNetworkReplyInitialSnapshot* snapshot = networkHistory.front();
-        networkHistory.pop_front();
-        snapshot->serialize(&fp);
+    if (m_bodyStore != 0) {
+        m_bodyStore->openReferences(networkFilePath);
+    }
+
+    QList<NetworkIndexEntry> index;
+
+    std::list<WebCore::QNetworkReplyInitialSnapshot*>::const_iterator iter = m_networkHistory.begin();
+    for (; iter != m_networkHistory.end(); ++iter) {
+        appendSnapshot(&fp, &index, *iter);
     }
 
     fp.close();
 
+    writeNetworkIndex(networkFilePath, index);
+
+    if (m_bodyStore != 0) {
+        m_bodyStore->closeReferences();
+    }
 }
 
 // WebERA STOP
@@ -25,6 +25,8 @@
 
 #include <QObject>
 #include <QList>
+#include <QFile>
+#include <QTimer>
 
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -37,6 +39,7 @@
 
 #include "WebCore/platform/network/FormData.h"
 #include "QtMIMETypeSniffer.h"
+#include "QNetworkSnapshotBodyStore.h"
 
 #include <QNetworkReply>
 
@@ -148,8 +151,14 @@ public:
         return new QList<QNetworkReplySnapshotEntry>(m_snapshots);
     }
 
-    void serialize(QIODevice* stream) const;
-    static QNetworkReplyInitialSnapshot* deserialize(QIODevice* stream);
+    // Bodies are written to (read from) the body store if one is given, see QNetworkSnapshotBodyStore
+    void serialize(QIODevice* stream, QNetworkSnapshotBodyStore* bodyStore = 0) const;
+    static QNetworkReplyInitialSnapshot* deserialize(QIODevice* stream, const QNetworkSnapshotBodyStore* bodyStore = 0); // returns 0 if the stream is truncated
+
+    // Hash of a stored body which could not be read from the body store, empty if the body is complete
+    const QByteArray& missingBodyHash() const {
+        return m_missingBodyHash;
+    }
 
     static unsigned int getNextSameUrlSequenceNumber(const QUrl& url);
 
@@ -171,6 +180,7 @@ protected:
 
     qint64 m_streamPosition; // points at the next value to read
     QByteArray m_stream;
+    QByteArray m_missingBodyHash;
 
     QList<QNetworkReplySnapshotEntry> m_snapshots;
 
@@ -266,6 +276,9 @@ public:
     // Subclasses should use this as an early dereference
     virtual QNetworkReply* release();
 
+    // Deliver the snapshots held back by the release gate, returns false if there is nothing to deliver
+    bool releaseHeldSnapshots();
+
     void updateSnapshot(Timer<QNetworkReplyControllable>* timer);
 
 signals:
@@ -280,6 +293,8 @@ protected:
 
     typedef QPair<QNetworkReplyInitialSnapshot::NetworkSignal, QNetworkReplySnapshot*> QueuedSnapshot;
     QList<QueuedSnapshot> m_snapshotQueue;
+    QList<QueuedSnapshot> m_heldSnapshots; // see QNetworkReplyReleaseGate
+    bool m_released;
 
     unsigned long m_sequenceNumber;
     bool m_nextSnapshotUpdateTimerRunning;
@@ -319,6 +334,57 @@ public slots:
 
 };
 
+/**
+ * WebERA: Releases finished replies one at a time in a seeded order (reduced variance record mode).
+ *
+ * Snapshots of a reply are held back until the reply has finished. A held reply is released once no request is in
+ * flight, the previously released reply has been delivered and no timer is due, such that the page has done everything
+ * it would do without new network input. The released reply is picked by a seeded PRNG from the held replies ordered by
+ * url and same url sequence number, thus the order of network event actions depends on the seed and not on network
+ * timing. If requests stay in flight for STALL_TIMEOUT ms, a held reply is released anyway, and these requests (e.g.
+ * long-polling) are no longer waited for.
+ *
+ * This reduces the variance between recordings, but does not make them reproducible: DOM timers fire after wall-clock
+ * delays, thus "no timer due" and the stall timeout still depend on timing.
+ */
+class QNetworkReplyReleaseGate : public QObject {
+    Q_OBJECT
+
+public:
+    QNetworkReplyReleaseGate(QNetworkReplyControllableFactory* factory, unsigned int seed);
+
+    void hold(QNetworkReplyControllable* controllable);
+    void delivered(QNetworkReplyControllable* controllable);
+    void forget(QNetworkReplyControllable* controllable);
+
+    // Replies held back or being delivered
+    unsigned int pendingCounter() const {
+        return m_held.size() + (m_releasing != 0 ? 1 : 0);
+    }
+
+    static const int STALL_TIMEOUT = 10000;
+
+public slots:
+    void releaseNext();
+    void slStalled();
+
+private:
+    void scheduleRelease(int delay = 0);
+    unsigned int nextRandom();
+    unsigned int awaitedCounter() const;
+
+    QNetworkReplyControllableFactory* m_factory;
+
+    std::list<QNetworkReplyControllable*> m_held;
+    QNetworkReplyControllable* m_releasing;
+
+    QTimer m_releaseTimer;
+    QTimer m_stallTimer;
+    std::set<QNetworkReplyControllable*> m_stalledRequests; // in flight when the gate stalled, not waited for again
+
+    unsigned int m_random;
+};
+
 /** Controllable Factory **/
 
 class QNetworkReplyControllableFactory
@@ -332,12 +398,70 @@ public:
 
     void controllableDone(QNetworkReplyControllable* controllable);
     void controllableConstructed(QNetworkReplyControllable* controllable);
+    void controllableFinished(QNetworkReplyControllable* controllable);
+    void controllableDelivered(QNetworkReplyControllable* controllable);
     void writeNetworkFile(QString networkFilePath);
 
+    // WebERA: Release finished replies in a seeded order instead of as they arrive, see QNetworkReplyReleaseGate
+    void setSeededRelease(unsigned int seed);
+
+    bool holdsSnapshots() const {
+        return m_releaseGate != 0;
+    }
+
+    /**
+     * WebERA: Stream snapshots to networkFilePath as requests finish, instead of keeping them in memory until
+     * writeNetworkFile is called (with the same path) at shutdown.
+     *
+     * Snapshots are appended in the order requests finish (or are aborted), and freed when their request is done.
+     * Requests still in flight are appended by writeNetworkFile, which also writes the index. The index is removed
+     * when streaming starts, such that a recording which did not shut down cleanly has no index, and readers fall
+     * back to scanning the network file.
+     */
+    bool streamNetworkFile(QString networkFilePath);
+
+    // WebERA: Store bodies in a (shared) body store instead of the network file, the factory does not take ownership
+    void setBodyStore(QNetworkSnapshotBodyStore* bodyStore) {
+        m_bodyStore = bodyStore;
+    }
+
+    QNetworkSnapshotBodyStore* bodyStore() const {
+        return m_bodyStore;
+    }
+
+    /**
+     * WebERA: writeNetworkFile also writes an index next to the network file, containing one entry for each snapshot
+     *
+     * magic (quint32), version (quint32), followed by entries of url (QUrl), same url sequence number (quint32),
+     * offset (qint64) and length (qint64) of the serialized snapshot in the network file.
+     *
+     * Snapshots with the same url are not necessarily stored in sequence number order, readers should order them.
+     */
+    static QString networkIndexPath(QString networkFilePath) {
+        return networkFilePath + ".index";
+    }
+
+    static const quint32 NETWORK_INDEX_MAGIC = 0x52344e49; // "R4NI"
+    static const quint32 NETWORK_INDEX_VERSION = 1;
+
     unsigned int doneCounter() const {
         return m_doneCounter;
     }
 
+    // Requests without a finished reply yet, their remaining snapshots are delivered through timers
+    unsigned int pendingCounter() const {
+        return m_openNetworkSessions.size() + (m_releaseGate != 0 ? m_releaseGate->pendingCounter() : 0);
+    }
+
+    // Requests without a finished reply yet
+    unsigned int inFlightCounter() const {
+        return m_openNetworkSessions.size();
+    }
+
+    const std::set<QNetworkReplyControllable*>& inFlight() const {
+        return m_openNetworkSessions;
+    }
+
     static QNetworkReplyControllableFactory* getFactory();
     static void setFactory(QNetworkReplyControllableFactory* factory);
 
@@ -346,8 +470,27 @@ protected:
 
 private:
     unsigned int m_doneCounter;
+
+    // If streaming, this only contains the snapshots not yet written to the network file
     std::list<WebCore::QNetworkReplyInitialSnapshot*> m_networkHistory;
 
+    struct NetworkIndexEntry {
+        QUrl url;
+        quint32 sameUrlSequenceNumber;
+        qint64 offset;
+        qint64 length;
+    };
+
+    void appendSnapshot(QIODevice* fp, QList<NetworkIndexEntry>* index, WebCore::QNetworkReplyInitialSnapshot* snapshot);
+    void streamSnapshot(WebCore::QNetworkReplyInitialSnapshot* snapshot);
+    static void writeNetworkIndex(QString networkFilePath, const QList<NetworkIndexEntry>& index);
+
+    QFile m_streamFile;
+    QList<NetworkIndexEntry> m_streamIndex;
+
+    QNetworkSnapshotBodyStore* m_bodyStore;
+    QNetworkReplyReleaseGate* m_releaseGate;
+
     static QNetworkReplyControllableFactory* m_factory;
 };
 
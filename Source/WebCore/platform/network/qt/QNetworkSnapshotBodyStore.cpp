@@ -0,0 +1,179 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "QNetworkSnapshotBodyStore.h"
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <wtf/SHA256.h>
+
+namespace WebCore {
+
+const char* const QNetworkSnapshotBodyStore::BODY_HEADER = "X-WebERA-Body-SHA256";
+
+QNetworkSnapshotBodyStore::QNetworkSnapshotBodyStore(QString path, AccessMode mode, int minimumBodySize)
+    : m_path(path)
+    , m_mode(mode)
+    , m_minimumBodySize(minimumBodySize)
+    , m_temporaryCounter(0)
+{
+    QDir dir;
+
+    if (m_mode == READ_ONLY) {
+        m_valid = dir.exists(m_path + "/objects");
+    } else {
+        m_valid = dir.mkpath(m_path + "/objects") && dir.mkpath(m_path + "/refs");
+    }
+}
+
+QNetworkSnapshotBodyStore::~QNetworkSnapshotBodyStore()
+{
+    closeReferences();
+}
+
+QByteArray QNetworkSnapshotBodyStore::hash(const QByteArray& body)
+{
+    SHA256 sha256;
+    sha256.addBytes(reinterpret_cast<const uint8_t*>(body.constData()), body.size());
+
+    Vector<uint8_t, 32> digest;
+    sha256.computeHash(digest);
+
+    return QByteArray(reinterpret_cast<const char*>(digest.data()), digest.size()).toHex();
+}
+
+QString QNetworkSnapshotBodyStore::objectPath(const QByteArray& hash) const
+{
+    return m_path + "/objects/" + QString::fromLatin1(hash.left(2)) + "/" + QString::fromLatin1(hash.mid(2));
+}
+
+QByteArray QNetworkSnapshotBodyStore::put(const QByteArray& body)
+{
+    if (m_mode == READ_ONLY) {
+        return QByteArray();
+    }
+
+    QByteArray digest = hash(body);
+    QString target = objectPath(digest);
+
+    if (QFile::exists(target)) {
+        // Mark the body as recently used, the garbage collector leaves recent bodies alone
+        utime(QFile::encodeName(target).constData(), 0);
+
+        addReference(digest);
+        return digest;
+    }
+
+    if (!QDir().mkpath(QFileInfo(target).path())) {
+        return QByteArray();
+    }
+
+    // Write to a temporary file first, such that readers never see a partially written body
+    QString temporary = target + ".tmp." + QString::number(getpid()) + "." + QString::number(m_temporaryCounter++);
+
+    QFile fp(temporary);
+    if (!fp.open(QIODevice::WriteOnly)) {
+        return QByteArray();
+    }
+
+    bool written = fp.write(body) == body.size();
+    fp.close();
+
+    if (!written || !QFile::rename(temporary, target)) {
+        QFile::remove(temporary);
+
+        // Another recorder could have stored the same body in the meantime
+        if (!QFile::exists(target)) {
+            return QByteArray();
+        }
+    }
+
+    addReference(digest);
+    return digest;
+}
+
+bool QNetworkSnapshotBodyStore::get(const QByteArray& hash, QByteArray* body) const
+{
+    if (hash.size() != 64 || QByteArray::fromHex(hash).toHex() != hash) {
+        return false; // not a (lower case) hex SHA-256
+    }
+
+    QFile fp(objectPath(hash));
+    if (!fp.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    *body = fp.readAll();
+    return true;
+}
+
+bool QNetworkSnapshotBodyStore::openReferences(QString networkFilePath)
+{
+    closeReferences();
+
+    if (m_mode == READ_ONLY) {
+        return false;
+    }
+
+    QString logPath = QFileInfo(networkFilePath).absoluteFilePath();
+
+    m_references.setFileName(m_path + "/refs/" + QString::fromLatin1(hash(logPath.toUtf8())));
+    if (!m_references.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    m_references.write("log " + logPath.toUtf8() + "\n");
+    m_references.flush();
+
+    return true;
+}
+
+void QNetworkSnapshotBodyStore::closeReferences()
+{
+    if (m_references.isOpen()) {
+        m_references.close();
+    }
+
+    m_referenced.clear();
+}
+
+void QNetworkSnapshotBodyStore::addReference(const QByteArray& hash)
+{
+    if (!m_references.isOpen() || m_referenced.contains(hash)) {
+        return;
+    }
+
+    m_referenced.insert(hash);
+
+    // Flushed right away, such that the references of a crashed recorder are kept as well
+    m_references.write(hash + "\n");
+    m_references.flush();
+}
+
+}
@@ -0,0 +1,103 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE COMPUTER, INC. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL APPLE COMPUTER, INC. OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef QNETWORKSNAPSHOTBODYSTORE_H
+#define QNETWORKSNAPSHOTBODYSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QSet>
+#include <QString>
+
+namespace WebCore {
+
+/**
+ * WebERA: Content addressed store for the bodies of network snapshots, shared between recordings.
+ *
+ * Snapshots with a stored body keep an empty body and reference the stored body by its SHA-256 (see BODY_HEADER),
+ * such that recordings of the same site share a single copy of their static assets. The store directory contains
+ *
+ *   objects/<first 2 hex digits>/<remaining 62 hex digits>   the bodies, named by their SHA-256
+ *   refs/<SHA-256 of the network log path>                   "log <network log path>", followed by one hash per line
+ *
+ * A body is referenced once by each network log containing it. Reference counts are derived from the refs files by
+ * R4/utils/bodystore.py, which also releases the references of deleted recordings and removes unreferenced bodies.
+ *
+ * A READ_ONLY store never stores bodies nor references, network logs written through it keep their bodies. Replays use
+ * it, as their network logs can be temporary (-in_dir extraction) or packed into a container (-out_pack), and the
+ * garbage collector would release the references of such logs while the container still needs the bodies.
+ */
+class QNetworkSnapshotBodyStore {
+
+public:
+    enum AccessMode {
+        READ_WRITE,
+        READ_ONLY
+    };
+
+    QNetworkSnapshotBodyStore(QString path, AccessMode mode = READ_WRITE, int minimumBodySize = DEFAULT_MINIMUM_BODY_SIZE);
+    ~QNetworkSnapshotBodyStore();
+
+    bool isValid() const {
+        return m_valid;
+    }
+
+    const QString& path() const {
+        return m_path;
+    }
+
+    // Smaller bodies are kept in the network log, they are not worth a file of their own
+    bool shouldStore(const QByteArray& body) const {
+        return m_mode == READ_WRITE && body.size() >= m_minimumBodySize;
+    }
+
+    // Returns the (hex) hash referencing body, or an empty array if the body could not be stored
+    QByteArray put(const QByteArray& body);
+    bool get(const QByteArray& hash, QByteArray* body) const;
+
+    // Bodies stored (or reused) until closeReferences are referenced by networkFilePath, replacing earlier references
+    bool openReferences(QString networkFilePath);
+    void closeReferences();
+
+    static QByteArray hash(const QByteArray& body);
+
+    static const char* const BODY_HEADER;
+    static const int DEFAULT_MINIMUM_BODY_SIZE = 1024;
+
+private:
+    QString objectPath(const QByteArray& hash) const;
+    void addReference(const QByteArray& hash);
+
+    QString m_path;
+    AccessMode m_mode;
+    int m_minimumBodySize;
+    bool m_valid;
+
+    QFile m_references;
+    QSet<QByteArray> m_referenced;
+    unsigned int m_temporaryCounter;
+};
+
+}
+
+#endif // QNETWORKSNAPSHOTBODYSTORE_H
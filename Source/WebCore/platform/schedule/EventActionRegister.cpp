@@ -46,11 +46,91 @@ public:
 
     typedef std::set<std::string> DescriptorSet;
     DescriptorSet m_currentDescriptors; // keys in m_descriptorToHandler
+
+    typedef std::map<std::string, WaitingEventAction> IndexBucket; // the key is the descriptors toString()
+    typedef std::map<std::string, IndexBucket> WaitingIndex; // the key is computed by m_indexKeyFunction
+    WaitingIndex m_waitingIndex;
+
+    typedef std::map<std::string, std::string> DescriptorToIndexKey; // the key is the descriptors toString()
+    DescriptorToIndexKey m_descriptorToIndexKey;
+
+    EventActionIndexKeyFunction m_indexKeyFunction;
+    EventActionIndexDataFunction m_indexDataFunction;
+    void* m_indexDataObject;
+
+    EventActionRegisterMaps()
+        : m_indexKeyFunction(0)
+        , m_indexDataFunction(0)
+        , m_indexDataObject(0)
+    {}
+
+    ~EventActionRegisterMaps()
+    {
+        clearIndex();
+    }
+
+    void addToIndex(const std::string& descriptorString, const WTF::EventActionDescriptor& descriptor)
+    {
+        if (!m_indexKeyFunction) {
+            return;
+        }
+
+        std::string indexKey = m_indexKeyFunction(descriptor);
+
+        if (indexKey.empty()) {
+            return;
+        }
+
+        WaitingEventAction waiting;
+        waiting.descriptor = descriptor;
+        waiting.data = m_indexDataFunction ? m_indexDataFunction(m_indexDataObject, descriptor) : 0;
+
+        m_waitingIndex[indexKey].insert(IndexBucket::value_type(descriptorString, waiting));
+        m_descriptorToIndexKey[descriptorString] = indexKey;
+    }
+
+    void removeFromIndex(const std::string& descriptorString)
+    {
+        DescriptorToIndexKey::iterator it = m_descriptorToIndexKey.find(descriptorString);
+
+        if (it == m_descriptorToIndexKey.end()) {
+            return;
+        }
+
+        WaitingIndex::iterator bucket = m_waitingIndex.find(it->second);
+        if (bucket != m_waitingIndex.end()) {
+            IndexBucket::iterator entry = bucket->second.find(descriptorString);
+
+            if (entry != bucket->second.end()) {
+                delete entry->second.data;
+                bucket->second.erase(entry);
+            }
+
+            if (bucket->second.empty()) {
+                m_waitingIndex.erase(bucket);
+            }
+        }
+
+        m_descriptorToIndexKey.erase(it);
+    }
+
+    void clearIndex()
+    {
+        for (WaitingIndex::iterator bucket = m_waitingIndex.begin(); bucket != m_waitingIndex.end(); bucket++) {
+            for (IndexBucket::iterator entry = bucket->second.begin(); entry != bucket->second.end(); entry++) {
+                delete entry->second.data;
+            }
+        }
+
+        m_waitingIndex.clear();
+        m_descriptorToIndexKey.clear();
+    }
 };
 
 EventActionRegister::EventActionRegister()
     : m_maps(new EventActionRegisterMaps)
     , m_isDispatching(false)
+    , m_dispatchNumber(0)
     , m_dispatchHistory(new EventActionSchedule())
     , m_verbose(false)
 {
@@ -73,7 +153,10 @@ void EventActionRegister::registerEventActionHandler(const WTF::EventActionDescr
 
     EventActionHandler target(f, object);
     m_maps->m_descriptorToHandler[key].push(target);
-    m_maps->m_currentDescriptors.insert(key);
+
+    if (m_maps->m_currentDescriptors.insert(key).second) {
+        m_maps->addToIndex(key, descriptor);
+    }
 }
 
 void EventActionRegister::deregisterEventActionHandler(const WTF::EventActionDescriptor& descriptor)
@@ -86,6 +169,7 @@ void EventActionRegister::deregisterEventActionHandler(const WTF::EventActionDes
     std::string key = descriptor.toString();
     m_maps->m_descriptorToHandler.erase(key);
     m_maps->m_currentDescriptors.erase(key);
+    m_maps->removeFromIndex(key);
 }
 
 bool EventActionRegister::runEventAction(const WTF::EventActionDescriptor& descriptor) {
@@ -169,6 +253,7 @@ bool EventActionRegister::runEventAction(WTF::EventActionId newEventActionId, WT
     if (l.empty()) {
         m_maps->m_descriptorToHandler.erase(descriptorString);
         m_maps->m_currentDescriptors.erase(descriptorString);
+        m_maps->removeFromIndex(descriptorString);
     }
 
     // Post-Execution
@@ -231,4 +316,37 @@ std::set<std::string> EventActionRegister::getWaitingNames()
     return m_maps->m_currentDescriptors;
 }
 
+void EventActionRegister::setWaitingIndexKeyFunction(EventActionIndexKeyFunction f, EventActionIndexDataFunction dataFunction, void* object)
+{
+    m_maps->clearIndex();
+    m_maps->m_indexKeyFunction = f;
+    m_maps->m_indexDataFunction = dataFunction;
+    m_maps->m_indexDataObject = object;
+
+    // Index handlers registered before the function was set
+
+    EventActionRegisterMaps::DescriptorSet::const_iterator it = m_maps->m_currentDescriptors.begin();
+    for (; it != m_maps->m_currentDescriptors.end(); it++) {
+        m_maps->addToIndex(*it, WTF::EventActionDescriptor::deserialize(*it));
+    }
+}
+
+std::vector<WaitingEventAction> EventActionRegister::getWaitingByIndexKey(const std::string& key) const
+{
+    std::vector<WaitingEventAction> result;
+
+    EventActionRegisterMaps::WaitingIndex::const_iterator bucket = m_maps->m_waitingIndex.find(key);
+
+    if (bucket == m_maps->m_waitingIndex.end()) {
+        return result;
+    }
+
+    EventActionRegisterMaps::IndexBucket::const_iterator it = bucket->second.begin();
+    for (; it != bucket->second.end(); it++) {
+        result.push_back(it->second);
+    }
+
+    return result;
+}
+
 }  // namespace WebCore
@@ -20,6 +20,21 @@
 namespace WebCore {
 
 typedef bool (*EventActionHandlerFunction)(void* object, const WTF::EventActionDescriptor& descriptor);
+typedef std::string (*EventActionIndexKeyFunction)(const WTF::EventActionDescriptor& descriptor);
+
+// Client data attached to an indexed waiting event action handler. Owned by the register, and deleted when the
+// handler is no longer waiting (or the index is rebuilt).
+class EventActionIndexData {
+public:
+    virtual ~EventActionIndexData() {}
+};
+
+typedef EventActionIndexData* (*EventActionIndexDataFunction)(void* object, const WTF::EventActionDescriptor& descriptor);
+
+struct WaitingEventAction {
+    WTF::EventActionDescriptor descriptor;
+    const EventActionIndexData* data; // 0 if no data function is set
+};
 
 class EventActionRegisterMaps;
 
@@ -76,10 +91,19 @@ public:
         return WTF::EventActionDescriptor::null;
     }
 
+    // Incremented each time an event action starts dispatching, used to cache data per dispatched event action
+    unsigned int currentEventActionDispatchNumber() const { return m_dispatchNumber; }
+
     EventActionSchedule* dispatchHistory() { return m_dispatchHistory; }
 
     std::set<std::string> getWaitingNames();
 
+    // Secondary index of waiting event action handlers, bucketed by a key computed by the given function when the
+    // handler is registered. Handlers for which the function returns an empty key are not indexed. The optional data
+    // function computes data stored with each indexed handler, such that clients can prepare it once per handler.
+    void setWaitingIndexKeyFunction(EventActionIndexKeyFunction f, EventActionIndexDataFunction dataFunction = 0, void* object = 0);
+    std::vector<WaitingEventAction> getWaitingByIndexKey(const std::string& key) const;
+
     void debugPrintNames(std::ostream& out) const;
 
     ActionLog::EventActionType toActionLogType(WTF::EventActionCategory category) {
@@ -131,6 +155,7 @@ private:
 
         m_dispatchHistory->append(EventActionScheduleItem(id, descriptor));
         m_isDispatching = true;
+        m_dispatchNumber++;
     }
 
     void eventActionDispatchEnd(bool commit, WTF::EventActionId originalId)
@@ -147,6 +172,7 @@ private:
 
     EventActionRegisterMaps* m_maps;
     bool m_isDispatching;
+    unsigned int m_dispatchNumber;
 
     EventActionSchedule* m_dispatchHistory;
 
@@ -153,6 +153,7 @@ private:
 
     friend class DumpRenderTreeSupportQt;
     friend class QWebFrame;
+    friend class QWebFramePrivate;
     friend class QWebElementCollection;
     friend class QWebHitTestResult;
     friend class QWebHitTestResultPrivate;
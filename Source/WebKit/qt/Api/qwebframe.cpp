@@ -725,6 +725,18 @@ QString QWebFrame::toHtml() const
     return createMarkup(d->frame->document());
 }
 
+/*!
+    WebERA: Returns a hash of the structure (tags, attributes and text) of the document in this frame.
+
+    The hash is maintained incrementally by the DOM, thus this is cheap compared to hashing toHtml().
+*/
+uint QWebFrame::structuralHash() const
+{
+    if (!d->frame->document())
+        return 0;
+    return d->frame->document()->structuralHash();
+}
+
 /*!
     Returns the content of this frame converted to plain text, completely
     stripped of all HTML formatting.
@@ -1024,28 +1036,21 @@ bool QWebFrame::runAutomaticExploration() {
 
 QWebElement QWebFramePrivate::findElement(const WTF::String& nodeIdentifier)
 {
-    QList<QWebElement> allEls = q->findAllElements(QString::fromAscii("*")).toList();
+    Document* document = frame->document();
 
-    //fprintf(stderr, "Start QWE - %d elements\n", allEls.count());
-    QWebElement target;
-    foreach (QWebElement el, allEls) {
-        //std::cout << "CMP " << static_cast<Node*>(el.webkitNodePtr())->getNodeReplayIdentifier().ascii().data() << std::endl; // DEBUG
-        if (!el.isNull() && static_cast<Node*>(el.webkitNodePtr())->getNodeReplayIdentifier() == nodeIdentifier) {
-            target = el;
-            break;
-        }
-    }
+    if (!document || !document->documentElement())
+        return QWebElement();
 
-    if (target.isNull()) {
-        Node* root = static_cast<Node*>(q->documentElement().webkitNodePtr())->parentNode();
-        //std::cout << "CMP-ROOT " << root->getNodeReplayIdentifier().ascii().data() << std::endl;  // DEBUG
+    // WebERA: Resolved through the replay identifier index of the document instead of matching all elements
+    Element* element = document->elementByReplayIdentifier(nodeIdentifier);
 
-        if (root->getNodeReplayIdentifier() == nodeIdentifier) {
-            target = q->documentElement(); //  the node pointed to by document element is the HTML node, it cant point to the "real" root Node*
-        }
-    }
+    if (element)
+        return QWebElement(element);
+
+    if (document->getNodeReplayIdentifier() == nodeIdentifier)
+        return q->documentElement(); //  the node pointed to by document element is the HTML node, it cant point to the "real" root Node*
 
-    return target;
+    return QWebElement();
 }
 
 bool QWebFramePrivate::triggerEventOnNode(EventAttachLog::EventType type, const WTF::String& nodeIdentifier, QWebElement target)